@@ -10,6 +10,7 @@
 #include <sstream>
 #include <boost/algorithm/string/split.hpp>
 #include <boost/algorithm/string/classification.hpp>
+#include <boost/range/iterator_range.hpp>
 #include "Asset.hpp"
 
 
@@ -26,10 +27,13 @@ std::map<std::string, std::string> contents;
 
 void init(const std::string& path)
 {
-  auto text = ci::loadString(Asset::load(path));
+  // TIPS ファイルの内容を直接分割する(ファイル全体をstd::stringへコピーしない)
+  auto buffer = Asset::map(path)->getBuffer();
+  const auto* text = static_cast<const char*>(buffer->getData());
 
   std::vector<std::string> result;
-  boost::algorithm::split(result, text, boost::is_any_of("\t\n"), boost::token_compress_on);
+  boost::algorithm::split(result, boost::make_iterator_range(text, text + buffer->getSize()),
+                          boost::is_any_of("\t\n"), boost::token_compress_on);
 
   for (int i = 0; i < result.size(); i += 2)
   {
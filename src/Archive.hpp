@@ -2,11 +2,26 @@
 
 //
 // ゲーム内記録
+//   変更は追記だけの記録(records.json.log)に書き足し、大きくなったらまとめ直す
+//   ファイルの書き出しはPersistenceに任せる
+//   起動時はまとめた記録を読んでから、追記を順に反映する
+//
+// 追記の書式
+//   本体の長さ(可変長整数) 本体 adler32(4byte little endian)
+//   本体: 種類(1byte) 名前の長さ(可変長整数) 名前 値
+//
+// NOTICE 追記する値は変更後の値なので、同じ追記を何度反映しても結果は変わらない
+//        まとめ直しの途中で落ちても、古い追記から順に反映すれば元に戻る
 //
 
+#include <cstring>
+#include <zlib.h>
 #include <boost/noncopyable.hpp>
 #include "Score.hpp"
 #include "TextCodec.hpp"
+#include "Varint.hpp"
+#include "Persistence.hpp"
+#include "MappedFile.hpp"
 
 
 namespace ngs {
@@ -65,38 +80,177 @@ class Archive
       // 記録ファイルが無い
       create();
       DOUT << "Archive:create: " << full_path_ << std::endl;
-      return;
     }
-
-#if defined(OBFUSCATION_ARCHIVE)
-    auto text = TextCodec::load(full_path_.string());
-    try
+    else
     {
-      records_ = ci::JsonTree(text);
+#if defined(OBFUSCATION_ARCHIVE)
+      auto text = TextCodec::load(full_path_.string());
+      try
+      {
+        records_ = ci::JsonTree(text);
+      }
+      catch (ci::JsonTree::ExcJsonParserError&)
+      {
+        DOUT << "Archive broken." << std::endl;
+        create();
+      }
+#else
+      try
+      {
+        records_ = ci::JsonTree(ci::loadFile(full_path_));
+      }
+      catch (ci::JsonTree::ExcJsonParserError&)
+      {
+        DOUT << "Archive broken." << std::endl;
+        create();
+      }
+#endif
+      DOUT << "Archive:load: " << full_path_ << std::endl;
     }
-    catch (ci::JsonTree::ExcJsonParserError&)
+
+    // まとめ直す前の追記→現在の追記の順に反映
+    bool rotated = ci::fs::is_regular_file(old_journal_path_);
+    bool intact  = true;
+    if (rotated) intact = replayJournal(old_journal_path_) && intact;
+    intact = replayJournal(journal_path_) && intact;
+
+    // NOTICE まとめ直しの途中で終わっていたか、追記の途中で壊れていた
+    //        壊れた所より後ろに書き足さないよう、ここでまとめ直す
+    if (rotated || !intact)
     {
-      DOUT << "Archive broken." << std::endl;
-      create();
+      DOUT << "Archive:recover" << std::endl;
+      if (writeSnapshot(records_, full_path_))
+      {
+        removeFile(old_journal_path_);
+        removeFile(journal_path_);
+      }
     }
-#else
-    try
+  }
+
+  // 追記を反映
+  // 途中で壊れていたらfalse(壊れた所までは反映する)
+  bool replayJournal(const ci::fs::path& path)
+  {
+    // TIPS ファイルの内容を直接読む(大きいファイルはマップする)
+    MappedFile file(path.string());
+    if (!file.isValid()) return true;
+
+    const char* data = file.data();
+    size_t data_size = file.size();
+
+    size_t ofs = 0;
+    while (ofs < data_size)
     {
-      records_ = ci::JsonTree(ci::loadFile(full_path_));
+      uint32_t size;
+      if (!Varint::read(data, data_size, ofs, size)) return false;
+      if (data_size - ofs < size_t(size) + 4) return false;
+
+      const char* body = data + ofs;
+      uint32_t checksum = 0;
+      for (int i = 0; i < 4; ++i)
+      {
+        checksum |= uint32_t(u_char(body[size + i])) << (i * 8);
+      }
+      if (checksum != calcChecksum(body, size)) return false;
+      if (!applyEntry(body, size)) return false;
+
+      ofs += size + 4;
     }
-    catch (ci::JsonTree::ExcJsonParserError&)
+
+    if (path == journal_path_) journal_size_ = data_size;
+    DOUT << "Archive:replay: " << path << " " << data_size << std::endl;
+
+    return true;
+  }
+
+  // 追記を１つ反映
+  bool applyEntry(const char* body, size_t size)
+  {
+    if (size == 0) return false;
+
+    auto type  = u_char(body[0]);
+    size_t ofs = 1;
+
+    if (type == RESET)
     {
-      DOUT << "Archive broken." << std::endl;
+      records_.clear();
       create();
+      return true;
     }
-#endif
-    DOUT << "Archive:load: " << full_path_ << std::endl;
+
+    std::string id;
+    if (!readString(body, size, ofs, id)) return false;
+
+    switch (type)
+    {
+    case BOOL:
+      if (ofs == size) return false;
+      setValue(id, body[ofs] != 0);
+      return true;
+
+    case UINT:
+      {
+        uint32_t value;
+        if (!Varint::read(body, size, ofs, value)) return false;
+        setValue(id, value);
+      }
+      return true;
+
+    case DOUBLE:
+      {
+        if (size - ofs < 8) return false;
+        uint64_t bits = 0;
+        for (int i = 0; i < 8; ++i)
+        {
+          bits |= uint64_t(u_char(body[ofs + i])) << (i * 8);
+        }
+        double value;
+        std::memcpy(&value, &bits, sizeof(value));
+        setValue(id, value);
+      }
+      return true;
+
+    case STRING:
+      {
+        std::string value;
+        if (!readString(body, size, ofs, value)) return false;
+        setValue(id, value);
+      }
+      return true;
+
+    case ARRAY:
+      {
+        std::string text;
+        if (!readString(body, size, ofs, text)) return false;
+        try
+        {
+          // TIPS 読み込んだ配列には名前が無いので付け直す
+          auto json  = ci::JsonTree(text);
+          auto array = ci::JsonTree::makeArray(id);
+          for (const auto& child : json)
+          {
+            array.pushBack(child);
+          }
+          setArray(id, array);
+        }
+        catch (ci::JsonTree::ExcJsonParserError&)
+        {
+          return false;
+        }
+      }
+      return true;
+    }
+
+    return false;
   }
 
 
 public:
-  Archive(const std::string& path, const std::string& version) noexcept
-    : full_path_(getDocumentPath() / path),
+  Archive(const std::string& path, const std::string& version, Persistence& persistence) noexcept
+    : persistence_(persistence),
+      full_path_(getDocumentPath() / path),
+      journal_path_(full_path_.string() + ".log"),
+      old_journal_path_(full_path_.string() + ".log.old"),
       version_(version)
   {
     this->load();
@@ -215,16 +369,13 @@ public:
   template <typename T>
   void setRecord(const std::string& id, const T& value) noexcept
   {
-    auto json = ci::JsonTree(id, value);
-    if (records_.hasChild(id))
-    {
-      records_[id] = json;
-    }
-    else
-    {
-      records_.addChild(json);
-      DOUT << "new record value: " << id << std::endl;
-    }
+    setValue(id, value);
+
+    std::string body;
+    body.push_back(char(entryType(value)));
+    writeString(body, id);
+    writeValue(body, value);
+    appendEntry(body);
   }
 
   // 値に加算する
@@ -237,7 +388,13 @@ public:
 
   void setRecordArray(const std::string&id, const ci::JsonTree& json) noexcept
   {
-    records_[id] = json;
+    setArray(id, json);
+
+    std::string body;
+    body.push_back(char(ARRAY));
+    writeString(body, id);
+    writeString(body, json.serialize());
+    appendEntry(body);
   }
 
   const ci::JsonTree& getRecordArray(const std::string& id) const noexcept
@@ -259,14 +416,18 @@ public:
   }
 
 
+  // 変更を追記する
   void save()
   {
-#if defined(OBFUSCATION_ARCHIVE)
-    TextCodec::write(full_path_.string(), records_.serialize());
-#else
-    records_.write(full_path_);
-#endif
-    DOUT << "Archive:write: " << full_path_ << std::endl;
+    if (pending_.empty()) return;
+
+    // 大きくなったらまとめ直す
+    if ((journal_size_ + pending_.size()) > COMPACT_SIZE) compact();
+
+    DOUT << "Archive:append: " << pending_.size() << " bytes" << std::endl;
+    journal_size_ += pending_.size();
+    persistence_.append(journal_path_, std::move(pending_));
+    pending_.clear();
   }
 
   // 消去
@@ -280,6 +441,7 @@ public:
     records_.clear();
 
     this->create();
+    appendEntry(std::string(1, char(RESET)));
 
     this->setRecord("PM-PERCHASE01", purchased);
     this->setRecord("tutorial", tutorial);
@@ -304,11 +466,176 @@ public:
 
 
 private:
+  enum {
+    // 追記がこの大きさを超えたらまとめ直す
+    COMPACT_SIZE = 16 * 1024,
+  };
+
+  // 追記の種類
+  enum EntryType {
+    BOOL,
+    UINT,
+    DOUBLE,
+    STRING,
+    ARRAY,
+    // 全て消去
+    RESET,
+  };
+
+  static EntryType entryType(bool) noexcept               { return BOOL; }
+  static EntryType entryType(uint32_t) noexcept           { return UINT; }
+  static EntryType entryType(double) noexcept             { return DOUBLE; }
+  static EntryType entryType(const std::string&) noexcept { return STRING; }
+
+  static void writeValue(std::string& body, bool value) noexcept
+  {
+    body.push_back(char(value ? 1 : 0));
+  }
+
+  static void writeValue(std::string& body, uint32_t value) noexcept
+  {
+    Varint::write(body, value);
+  }
+
+  static void writeValue(std::string& body, double value) noexcept
+  {
+    uint64_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    for (int i = 0; i < 8; ++i)
+    {
+      body.push_back(char((bits >> (i * 8)) & 0xff));
+    }
+  }
+
+  static void writeValue(std::string& body, const std::string& value) noexcept
+  {
+    writeString(body, value);
+  }
+
+  static void writeString(std::string& body, const std::string& text) noexcept
+  {
+    Varint::write(body, uint32_t(text.size()));
+    body.append(text);
+  }
+
+  static bool readString(const char* body, size_t size, size_t& ofs, std::string& text) noexcept
+  {
+    uint32_t length;
+    if (!Varint::read(body, size, ofs, length) || (size - ofs) < length) return false;
+
+    text.assign(body + ofs, length);
+    ofs += length;
+    return true;
+  }
+
+  static uint32_t calcChecksum(const char* body, size_t size) noexcept
+  {
+    return uint32_t(adler32(adler32(0, Z_NULL, 0), reinterpret_cast<const Bytef*>(body), uInt(size)));
+  }
+
+  // 保存待ちの追記に加える
+  void appendEntry(const std::string& body) noexcept
+  {
+    Varint::write(pending_, uint32_t(body.size()));
+    pending_.append(body);
+
+    auto checksum = calcChecksum(body.data(), body.size());
+    for (int i = 0; i < 4; ++i)
+    {
+      pending_.push_back(char((checksum >> (i * 8)) & 0xff));
+    }
+  }
+
+  template <typename T>
+  void setValue(const std::string& id, const T& value) noexcept
+  {
+    auto json = ci::JsonTree(id, value);
+    if (records_.hasChild(id))
+    {
+      records_[id] = json;
+    }
+    else
+    {
+      records_.addChild(json);
+      DOUT << "new record value: " << id << std::endl;
+    }
+  }
+
+  void setArray(const std::string& id, const ci::JsonTree& json) noexcept
+  {
+    records_[id] = json;
+  }
+
+
+  // 今の記録を書き出し、それまでの追記を捨てる
+  // NOTICE 追記はまとめ直す前のものとして残しておき、書き出しが終わってから消す
+  //        書き出し用のスレッドで行うので、それより前に頼んだ追記は済んでいる
+  void compact() noexcept
+  {
+    journal_size_ = 0;
+
+    // TIPS 書き出す記録は複製しておく(書き出し中も記録は変わる)
+    persistence_.post([records = records_, path = full_path_,
+                       journal_path = journal_path_, old_path = old_journal_path_]()
+                      {
+                        // 前回の書き出しに失敗している
+                        if (ci::fs::exists(old_path)) return;
+
+                        try
+                        {
+                          if (ci::fs::exists(journal_path)) ci::fs::rename(journal_path, old_path);
+                        }
+                        catch (ci::fs::filesystem_error& ex)
+                        {
+                          DOUT << ex.what() << std::endl;
+                          return;
+                        }
+
+                        if (writeSnapshot(records, path)) removeFile(old_path);
+                      });
+  }
+
+  // 記録を丸ごと書き出す
+  static bool writeSnapshot(const ci::JsonTree& records, const ci::fs::path& path) noexcept
+  {
+#if defined(OBFUSCATION_ARCHIVE)
+    auto data = TextCodec::encode(records.serialize());
+#else
+    auto data = records.serialize();
+#endif
+    if (!Persistence::writeFile(path, data)) return false;
+
+    DOUT << "Archive:write: " << path << std::endl;
+    return true;
+  }
+
+  static void removeFile(const ci::fs::path& path) noexcept
+  {
+    try
+    {
+      ci::fs::remove(path);
+    }
+    catch (ci::fs::filesystem_error& ex)
+    {
+      DOUT << ex.what() << std::endl;
+    }
+  }
+
+
+  Persistence& persistence_;
+
   std::string version_;
 
   ci::fs::path full_path_;
+  ci::fs::path journal_path_;
+  ci::fs::path old_journal_path_;
 
   ci::JsonTree records_;
+
+  // 保存待ちの追記
+  std::string pending_;
+  // 追記ファイルの大きさ
+  size_t journal_size_ = 0;
 };
 
 }
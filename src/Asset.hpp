@@ -5,13 +5,23 @@
 //  OSX版のみDEBUGビルドで特殊なパスから読み込むようにしている
 //
 
+#include <memory>
+#include <cinder/DataSource.h>
 #include "Path.hpp"
+#include "MappedFile.hpp"
 
 
 namespace ngs { namespace Asset {
 
 ci::DataSourceRef load(const std::string& path);
 
+// NOTICE 以下はJSON、テキスト、シェーダー向け
+//        画像や音声はファイルのパスが必要なローダーがあるのでloadを使う
+// ファイルの内容を参照する(コピーしない)
+ci::DataSourceRef map(const std::string& path);
+// ファイルの内容をstd::stringで受け取る(コピーは１回だけ)
+std::string loadString(const std::string& path);
+
 
 #if defined (NGS_ASSET_IMPLEMENTATION)
 
@@ -20,6 +30,38 @@ ci::DataSourceRef load(const std::string& path)
   return ci::loadFile(getAssetPath(path));
 }
 
+ci::DataSourceRef map(const std::string& path)
+{
+  auto full_path = getAssetPath(path);
+  auto file = std::make_shared<MappedFile>(full_path.string());
+  if (!file->isValid())
+  {
+    // 開けない時は通常の読み込み(例外もそのまま)
+    return ci::loadFile(full_path);
+  }
+
+  // TIPS Bufferはfileの内容を参照するだけ(コピーも解放もしない)
+  //      Bufferが破棄されるまでfileを残しておく
+  ci::BufferRef buffer(new ci::Buffer(const_cast<char*>(file->data()), file->size()),
+                       [file](ci::Buffer* b)
+                       {
+                         delete b;
+                       });
+  return ci::DataSourceBuffer::create(buffer, full_path);
+}
+
+std::string loadString(const std::string& path)
+{
+  auto full_path = getAssetPath(path);
+  MappedFile file(full_path.string());
+  if (!file.isValid())
+  {
+    return ci::loadString(ci::loadFile(full_path));
+  }
+
+  return file.release();
+}
+
 #endif
 
 } }
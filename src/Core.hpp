@@ -22,6 +22,7 @@
 #include "Settings.hpp"
 #include "Records.hpp"
 #include "Ranking.hpp"
+#include "Persistence.hpp"
 #include "Archive.hpp"
 #include "Sound.hpp"
 #include "DebugTask.hpp"
@@ -40,7 +41,8 @@ public:
     : params_(params),
       event_(event),
       achievements_(event),
-      archive_("records.json", params.getValueForKey<std::string>("app.version")),
+      persistence_(event),
+      archive_("records.json", params.getValueForKey<std::string>("app.version"), persistence_),
       drawer_(params["ui"]),
       tween_common_(Params::load("tw_common.json"))
   {
@@ -266,7 +268,7 @@ public:
     
     // 最初のタスクを登録
     tasks_.pushBack<Sound>(params_, event_);
-    tasks_.pushBack<MainPart>(params_, event_, archive_);
+    tasks_.pushBack<MainPart>(params_, event_, archive_, persistence_);
     {
       Intro::Condition condition{
         Archive::isTutorial(archive_),
@@ -346,6 +348,10 @@ private:
   // 課金の価格
   std::string price_;
 
+  // ファイルの書き出し
+  // NOTICE Archiveより先に作り、後で破棄する
+  Persistence persistence_;
+
   // ゲーム内記録
   Archive archive_;
 
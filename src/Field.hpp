@@ -2,13 +2,23 @@
 
 //
 // パネルを置く場所
+//   複製は升目の塊を共有し、書き換える時に塊ごと複製する(copy-on-write)
+//   塊には作ったFieldの所有札を付け、札が一致する時だけその場で書き換える
+//   addPanelで記録を取れば、最後に置いたパネルから順に取り除ける
 //
 
-#include <map>
-#include <boost/noncopyable.hpp>
+#include <vector>
+#include <array>
+#include <memory>
+#include <atomic>
+#include <random>
+#include <climits>
+#include <cmath>
+#include <cassert>
 #include <glm/glm.hpp>
 #include <algorithm>
-#include "Utility.hpp"
+#include "Misc.hpp"
+#include "Panel.hpp"
 
 
 namespace ngs {
@@ -24,93 +34,394 @@ struct PanelStatus
 };
 
 
+// 置ける場所の周囲の端情報
+//   隣にパネルがある辺だけmaskが立っている
+struct BlankEdge
+{
+  uint64_t edge;
+  uint64_t mask;
+
+  // 回転済みの端情報が合うか
+  bool match(uint64_t panel_edge) const noexcept
+  {
+    return (panel_edge & mask) == edge;
+  }
+};
+
+// 同じ端情報の置ける場所の数
+struct BlankPattern
+{
+  BlankEdge blank;
+  int count;
+};
+
+
 struct Field
 {
+  // 一手戻すための記録(addPanelが書き込む)
+  struct Undo;
+
   Field()  = default;
   ~Field() = default;
 
 
-  // Jsonから状況を復元
-  Field(const ci::JsonTree& json) noexcept
+  bool existsPanel(const glm::ivec2& pos) const noexcept
   {
-    for (const auto& obj : json)
-    {
-      auto number   = obj.template getValueForKey<int>("number");
-      auto pos      = Json::getVec<glm::ivec2>(obj["pos"]);
-      auto rotation = obj.template getValueForKey<u_int>("rotation");
-      auto edge     = Json::getValue<uint64_t>(obj, "edge", 0);
+    return getCell(pos).panel >= 0;
+  }
 
-      addPanel(number, pos, rotation, edge);
-    }
+  const PanelStatus& getPanelStatus(const glm::ivec2& pos) const noexcept
+  {
+    auto index = getCell(pos).panel;
+    assert(index >= 0);
+    return panel_status_[index];
+  }
+
+  // 置いた順番(パネルが無ければ-1)
+  int getPanelIndex(const glm::ivec2& pos) const noexcept
+  {
+    return getCell(pos).panel;
+  }
+
+  // パネルが置ける場所か？
+  bool isBlank(const glm::ivec2& pos) const noexcept
+  {
+    return getCell(pos).blank >= 0;
+  }
+
+  // 置ける場所の一覧(パネルに隣接した空き)
+  // NOTICE 並び順は不定
+  const std::vector<glm::ivec2>& getBlankPositions() const noexcept
+  {
+    return blank_;
+  }
+
+  // 置ける場所の周囲の端情報(getBlankPositionsと同じ並び)
+  const std::vector<BlankEdge>& getBlankEdges() const noexcept
+  {
+    return blank_edge_;
   }
 
+  const BlankEdge& getBlankEdge(const glm::ivec2& pos) const noexcept
+  {
+    auto index = getCell(pos).blank;
+    assert(index >= 0);
+    return blank_edge_[index];
+  }
 
-  // 置ける場所を探す
-  std::vector<glm::ivec2> searchBlank() const noexcept
+  // 置ける場所の周囲の端情報を種類ごとにまとめたもの
+  // TIPS 盤面が広がっても種類の数はほとんど増えないので、置けるかどうかの判定に使う
+  const std::vector<BlankPattern>& getBlankPatterns() const noexcept
   {
-    // TIPS 重複する場所の列挙を回避できる
-    std::set<glm::ivec2, LessVec<glm::ivec2>> blank_candidate;
+    return blank_pattern_;
+  }
 
+  // 追加
+  // attribute: パネルの属性(検索用)
+  // undo: removePanelで取り除くための記録(不要ならnullptr)
+  void addPanel(int number, const glm::ivec2& pos, u_int rotation, uint64_t edge, u_int attribute,
+                Undo* undo = nullptr) noexcept
+  {
+    PanelStatus status = {
+      pos,
+      number,
+      rotation,
+      edge
+    };
+
+    auto& cell = reserveCell(pos);
+    int index  = int(panel_status_.size());
+    cell.panel = index;
+
+    panel_status_.push_back(status);
+    panel_pos_array_.push_back(pos);
+
+    if (undo)
+    {
+      undo->position = pos;
+      undo->blank    = cell.blank;
+      if (cell.blank >= 0) undo->blank_edge = blank_edge_[cell.blank];
+      undo->new_blank    = 0;
+      undo->panel_extent = panel_extent_;
+    }
+
+    // 範囲を広げる
+    panel_sum_ += pos;
+    for (u_int i = 0; i < EXTENT_NUM; ++i)
+    {
+      panel_extent_[i] = std::max(panel_extent_[i], extentValue(pos, i));
+    }
+
+    // 属性と端の種類ごとに登録
+    for (u_int i = 0; i < ATTRIBUTE_NUM; ++i)
+    {
+      if (attribute & (1 << i)) attribute_index_[i].push_back(index);
+    }
+    for (u_int i = 0; i < EDGE_NUM; ++i)
+    {
+      if (edge & bundleEdgeType(1 << i)) edge_index_[i].push_back(index);
+    }
+    open_edge_slot_.push_back({{ -1, -1, -1, -1 }});
+
+    // 置ける場所を更新
+    //   置いた場所を取り除き、周囲の空きを加える
+    if (cell.blank >= 0) removeBlank(cell);
+
+    // 時計回りに調べる
     static const glm::ivec2 offsets[] = {
-      { -1,  0 },
+      {  0,  1 },
       {  1,  0 },
       {  0, -1 },
+      { -1,  0 },
+    };
+
+    for (u_int i = 0; i < 4; ++i)
+    {
+      auto p = pos + offsets[i];
+      auto& c = reserveCell(p);
+      if (c.panel >= 0)
+      {
+        // 隣のパネルの端が塞がった
+        updateOpenEdge(c.panel);
+        continue;
+      }
+
+      if (c.blank < 0)
+      {
+        c.blank = int(blank_.size());
+        blank_.push_back(p);
+        blank_edge_.push_back({ 0, 0 });
+        blank_sum_ += p;
+        if (undo) undo->new_blank |= 1 << i;
+      }
+      else
+      {
+        removePattern(blank_edge_[c.blank]);
+      }
+
+      // 隣の置ける場所から見て向かい側の辺に、置いたパネルの端情報を書き込む
+      u_int shift  = ((i + 2) % 4) * 16;
+      auto& blank_edge = blank_edge_[c.blank];
+      blank_edge.edge |= ((edge >> (i * 16)) & Panel::EDGE_MASK) << shift;
+      blank_edge.mask |= uint64_t(Panel::EDGE_MASK) << shift;
+      addPattern(blank_edge);
+    }
+    updateOpenEdge(index);
+  }
+
+  // 最後に置いたパネルを取り除く
+  // NOTICE addPanelと逆の順番で呼ぶ。置ける場所の並びも元に戻る
+  void removePanel(const Undo& undo) noexcept
+  {
+    const auto& pos = undo.position;
+    int index = int(panel_status_.size()) - 1;
+    assert(index >= 0 && panel_pos_array_[index] == pos);
+
+    // 空き升目に面した端の一覧から外す
+    auto& slot = open_edge_slot_[index];
+    for (u_int i = 0; i < EDGE_NUM; ++i)
+    {
+      if (slot[i] < 0) continue;
+
+      auto& list = open_edge_index_[i];
+      open_edge_slot_[list.back()][i] = slot[i];
+      list[slot[i]] = list.back();
+      list.pop_back();
+    }
+    open_edge_slot_.pop_back();
+
+    reserveCell(pos).panel = -1;
+
+    // 周囲の置ける場所を戻す
+    // TIPS 新しく加えた場所は末尾に並んでいるので、逆順に取り除く
+    static const glm::ivec2 offsets[] = {
       {  0,  1 },
+      {  1,  0 },
+      {  0, -1 },
+      { -1,  0 },
     };
 
-    for (const auto& pos : panel_pos_array_)
+    for (int i = 3; i >= 0; --i)
     {
-      for (const auto& ofs : offsets)
+      auto p = pos + offsets[i];
+      auto& c = reserveCell(p);
+      if (c.panel >= 0)
       {
-        auto p = pos + ofs;
-        if (!panel_status_.count(p))
-        {
-          blank_candidate.insert(p);
-        }
+        // 隣のパネルの端が空いた
+        updateOpenEdge(c.panel);
+        continue;
+      }
+
+      auto& blank_edge = blank_edge_[c.blank];
+      removePattern(blank_edge);
+      if (undo.new_blank & (1 << i))
+      {
+        assert(c.blank == int(blank_.size()) - 1);
+        blank_sum_ -= p;
+        blank_.pop_back();
+        blank_edge_.pop_back();
+        c.blank = -1;
+        continue;
       }
+
+      // 置いたパネルが書き込んだ辺を消す
+      u_int shift = ((i + 2) % 4) * 16;
+      blank_edge.edge &= ~(uint64_t(Panel::EDGE_MASK) << shift);
+      blank_edge.mask &= ~(uint64_t(Panel::EDGE_MASK) << shift);
+      addPattern(blank_edge);
     }
 
-    std::vector<glm::ivec2> blank;
-    appendContainer(blank_candidate, blank);
+    // 置いた場所を置ける場所に戻す
+    if (undo.blank >= 0) restoreBlank(pos, undo.blank, undo.blank_edge);
 
-    return blank;
-  }
+    for (auto& list : attribute_index_)
+    {
+      if (!list.empty() && list.back() == index) list.pop_back();
+    }
+    for (auto& list : edge_index_)
+    {
+      if (!list.empty() && list.back() == index) list.pop_back();
+    }
 
+    panel_status_.pop_back();
+    panel_pos_array_.pop_back();
 
-  bool existsPanel(const glm::ivec2& pos) const noexcept
+    panel_sum_   -= pos;
+    panel_extent_ = undo.panel_extent;
+  }
+
+  // 一番近い置ける場所(同じ距離の場所からは乱数で選ぶ)
+  // TIPS 置ける場所の一覧を使わず、posを囲む升目を内側から順に調べる
+  template <typename Engine>
+  bool searchNearestBlank(const glm::ivec2& pos, Engine& engine, glm::ivec2& result) const noexcept
   {
-    return panel_status_.count(pos);
+    if (blank_.empty()) return false;
+
+    // 置ける場所は全てパネルの１つ外側までにある
+    int max_radius = std::max(std::max(panel_extent_[0] - pos.x, panel_extent_[4] + pos.x),
+                              std::max(panel_extent_[2] - pos.y, panel_extent_[6] + pos.y)) + 1;
+
+    int best   = -1;
+    u_int ties = 0;
+    for (int r = 0; r <= max_radius; ++r)
+    {
+      // この周より内側で見つかっている
+      if ((best >= 0) && (r * r > best)) break;
+
+      for (int y = -r; y <= r; ++y)
+      {
+        // 上下の辺以外は両端だけ
+        int step = ((y == -r) || (y == r)) ? 1 : 2 * r;
+        for (int x = -r; x <= r; x += step)
+        {
+          auto p = pos + glm::ivec2(x, y);
+          if (getCell(p).blank < 0) continue;
+
+          int d = x * x + y * y;
+          if ((best < 0) || (d < best))
+          {
+            best   = d;
+            ties   = 1;
+            result = p;
+          }
+          else if (d == best)
+          {
+            // TIPS 同じ距離の場所から等確率で選ぶ(reservoir sampling)
+            ties += 1;
+            if (std::uniform_int_distribution<u_int>(0, ties - 1)(engine) == 0) result = p;
+          }
+        }
+      }
+    }
+
+    return best >= 0;
   }
 
-  const PanelStatus& getPanelStatus(const glm::ivec2& pos) const noexcept
+  // パネル(または置ける場所)の中心と、中心から一番遠い升目の角までの距離
+  // NOTICE 距離は升目を囲む八角形から求めるので、実際より僅かに大きいことがある
+  std::pair<glm::vec2, float> getCenterAndRadius(bool blank) const noexcept
   {
-    return panel_status_.at(pos);
+    if (panel_status_.empty()) return { glm::vec2(0), 0.0f };
+
+    const auto& sum = blank ? blank_sum_ : panel_sum_;
+    auto num        = blank ? blank_.size() : panel_status_.size();
+    glm::vec2 center(float(sum.x) / num, float(sum.y) / num);
+
+    // 八角形の各辺の位置
+    // TIPS 置ける場所はパネルの１つ外側にしか無い。升目の角は中心から0.5ずつずれる
+    float extent[EXTENT_NUM];
+    for (u_int i = 0; i < EXTENT_NUM; ++i)
+    {
+      bool diagonal = i & 1;
+      extent[i] = panel_extent_[i] + (blank ? 1.0f : 0.0f) + (diagonal ? 1.0f : 0.5f);
+    }
+
+    // 隣り合う辺の交点が八角形の頂点
+    float radius2 = 0;
+    for (u_int i = 0; i < EXTENT_NUM; i += 2)
+    {
+      // 軸方向の辺 dir・p = extent[i] と、斜め方向の辺 (dir + next)・p = extent[i + 1] の交点
+      auto axis = extentAxis(i);
+      auto next = extentAxis((i + 2) % EXTENT_NUM);
+      glm::vec2 a = axis * extent[i] + next * (extent[i + 1] - extent[i]);
+      glm::vec2 b = next * extent[(i + 2) % EXTENT_NUM] + axis * (extent[i + 1] - extent[(i + 2) % EXTENT_NUM]);
+
+      auto da = a - center;
+      auto db = b - center;
+      radius2 = std::max(radius2, std::max(da.x * da.x + da.y * da.y, db.x * db.x + db.y * db.y));
+    }
+
+    return { center, std::sqrt(radius2) };
   }
 
-  // 追加
-  void addPanel(int number, const glm::ivec2& pos, u_int rotation, uint64_t edge) noexcept
+  // 属性か端の種類を持つパネルの位置(置いた順)
+  // attribute, edge: 調べる属性と端の種類(複数指定はいずれかを持つもの)
+  // max_num: 最大何個探すか(0で全て)
+  std::vector<glm::ivec2> searchPanels(u_int attribute, u_int edge, size_t max_num = 0) const noexcept
   {
-    PanelStatus status = {
-      pos,
-      number,
-      rotation,
-      edge
-    };
+    const std::vector<int>* lists[ATTRIBUTE_NUM + EDGE_NUM];
+    size_t num = 0;
+    for (u_int i = 0; i < ATTRIBUTE_NUM; ++i)
+    {
+      if (attribute & (1 << i)) lists[num++] = &attribute_index_[i];
+    }
+    for (u_int i = 0; i < EDGE_NUM; ++i)
+    {
+      if (edge & (1 << i)) lists[num++] = &edge_index_[i];
+    }
 
-    panel_status_.emplace(pos, status);
-    panel_pos_array_.push_back(pos);
+    return mergeIndex(lists, num, max_num);
   }
 
-  std::vector<PanelStatus> enumeratePanels() const noexcept
+  // 空き升目に面した端を持つパネルの位置(置いた順)
+  // edge: 調べる端の種類(PATHやFORESTなど)
+  std::vector<glm::ivec2> searchOpenEdgePanels(u_int edge) const noexcept
   {
-    std::vector<PanelStatus> panels;
+    std::vector<int> indices;
+    for (u_int i = 0; i < EDGE_NUM; ++i)
+    {
+      if (!(edge & (1 << i))) continue;
+
+      const auto& list = open_edge_index_[i];
+      indices.insert(std::end(indices), std::begin(list), std::end(list));
+    }
+    // NOTICE 削除で順番が入れ替わるので並べ直す
+    std::sort(std::begin(indices), std::end(indices));
+    indices.erase(std::unique(std::begin(indices), std::end(indices)), std::end(indices));
 
-    for (const auto& pos : panel_pos_array_)
+    std::vector<glm::ivec2> positions;
+    positions.reserve(indices.size());
+    for (auto index : indices)
     {
-      const auto& status = panel_status_.at(pos);
-      panels.emplace_back(status);
+      positions.push_back(panel_pos_array_[index]);
     }
-    return panels;
+    return positions;
+  }
+
+  // NOTICE 置いた順序で並んでいる
+  const std::vector<PanelStatus>& enumeratePanels() const noexcept
+  {
+    return panel_status_;
   }
   
   const std::vector<glm::ivec2>& getPanelPositions() const noexcept
@@ -119,33 +430,382 @@ struct Field
   }
 
 
-  ci::JsonTree serialize() const noexcept
+private:
+  enum {
+    // 升目はこの大きさの塊ごとに確保する
+    CHUNK_SHIFT = 5,
+    CHUNK_SIZE  = 1 << CHUNK_SHIFT,
+
+    // 検索用に分ける属性(TOWN〜FORT)と端(PATH〜WATER)の種類
+    ATTRIBUTE_NUM = 6,
+    EDGE_NUM      = 4,
+
+    // 範囲を調べる方向(x, x+y, y, y-x, -x, -x-y, -y, x-yの順)
+    EXTENT_NUM = 8,
+  };
+
+public:
+  struct Undo
+  {
+    glm::ivec2 position;
+
+    // 置いた場所が置ける場所だった時の添字と端情報(違えば-1)
+    int blank;
+    BlankEdge blank_edge;
+    // 新しく置ける場所になった方向(時計回りのビット)
+    u_int new_blank;
+
+    std::array<int, EXTENT_NUM> panel_extent;
+  };
+
+private:
+
+  // 升目の情報
+  struct Cell
   {
-    ci::JsonTree data = ci::JsonTree::makeObject("field");
+    int panel = -1;         // panel_status_の添字
+    int blank = -1;         // blank_の添字
+  };
 
-    for (const auto& pos : panel_pos_array_)
+  // 升目の塊
+  struct Chunk
+  {
+    glm::ivec2 position;
+    // 作ったFieldの所有札
+    uint64_t owner;
+    std::array<Cell, CHUNK_SIZE * CHUNK_SIZE> cells;
+  };
+
+  // 所有札
+  //   複製すると、複製元と複製先の両方が新しい札に変わる
+  //   以前の札の塊は共有されているかもしれないので、書き換える前に複製する
+  // NOTICE 共有の判定にuse_count()は使わない
+  //        別スレッドが参照を手放したことを知る同期が無く、データ競合になる
+  // TIPS 複製元はconstでも札を変えるのでatomicにしておく
+  class Owner
+  {
+  public:
+    Owner() noexcept
+      : tag_(newTag())
+    {}
+
+    Owner(const Owner& other) noexcept
+      : tag_(newTag())
+    {
+      other.tag_.store(newTag(), std::memory_order_relaxed);
+    }
+
+    Owner& operator=(const Owner& other) noexcept
+    {
+      tag_.store(newTag(), std::memory_order_relaxed);
+      other.tag_.store(newTag(), std::memory_order_relaxed);
+      return *this;
+    }
+
+    uint64_t get() const noexcept
     {
-      const auto& status = panel_status_.at(pos);
+      return tag_.load(std::memory_order_relaxed);
+    }
 
-      ci::JsonTree p;
-      p.addChild(Json::createFromVec("pos", status.position))
-       .addChild(ci::JsonTree("number",     status.number))
-       .addChild(ci::JsonTree("rotation",   status.rotation))
-       .addChild(ci::JsonTree("edge",       status.edge))
-      ;
 
-      data.pushBack(p);
+  private:
+    static uint64_t newTag() noexcept
+    {
+      static std::atomic<uint64_t> next { 1 };
+      return next.fetch_add(1, std::memory_order_relaxed);
     }
 
-    return data;
+    mutable std::atomic<uint64_t> tag_;
+  };
+
+
+  // 座標→塊の位置
+  // TIPS 原点が塊の中央に来るようにずらす(普通のゲームは１つの塊に収まる)
+  static glm::ivec2 getChunkPosition(const glm::ivec2& pos) noexcept
+  {
+    auto p = pos + CHUNK_SIZE / 2;
+    // NOTICE 負数の右シフトは算術シフトを前提にしている
+    return glm::ivec2(p.x >> CHUNK_SHIFT, p.y >> CHUNK_SHIFT);
   }
 
+  // 座標→塊の中の添字
+  static int getCellIndex(const glm::ivec2& pos) noexcept
+  {
+    auto p = pos + CHUNK_SIZE / 2;
+    return (p.y & (CHUNK_SIZE - 1)) * CHUNK_SIZE + (p.x & (CHUNK_SIZE - 1));
+  }
+
+  static size_t hashChunk(const glm::ivec2& chunk) noexcept
+  {
+    uint64_t v = (uint64_t(uint32_t(chunk.x)) << 32) | uint32_t(chunk.y);
+    return size_t((v * 0x9e3779b97f4a7c15) >> 32);
+  }
+
+  // 塊を探す(無ければ-1)
+  // TIPS 開番地法のハッシュ表なので、Fieldの複製は配列のコピーで済む
+  int findChunk(const glm::ivec2& chunk) const noexcept
+  {
+    if (chunk_table_.empty()) return -1;
+    // TIPS 最初の塊だけで足りることが多いので先に調べる
+    if (chunks_[0]->position == chunk) return 0;
+
+    size_t mask = chunk_table_.size() - 1;
+    for (size_t i = hashChunk(chunk) & mask; ; i = (i + 1) & mask)
+    {
+      auto index = chunk_table_[i];
+      if ((index < 0) || (chunks_[index]->position == chunk)) return index;
+    }
+  }
+
+  const Cell& getCell(const glm::ivec2& pos) const noexcept
+  {
+    // 確保していない場所は何も無い升目
+    static const Cell empty;
+
+    auto index = findChunk(getChunkPosition(pos));
+    return (index >= 0) ? chunks_[index]->cells[getCellIndex(pos)] : empty;
+  }
+
+  // 升目を確保して返す
+  // NOTICE 塊を追加・複製すると、以前に返した参照は無効になる
+  Cell& reserveCell(const glm::ivec2& pos) noexcept
+  {
+    auto chunk = getChunkPosition(pos);
+    auto index = findChunk(chunk);
+    if (index < 0)
+    {
+      // 使用率が半分を超えたらハッシュ表を作り直す
+      if ((chunks_.size() + 1) * 2 > chunk_table_.size())
+      {
+        chunk_table_.assign(std::max(chunk_table_.size() * 2, size_t(8)), -1);
+        for (size_t i = 0; i < chunks_.size(); ++i)
+        {
+          insertChunkTable(chunks_[i]->position, int(i));
+        }
+      }
+
+      index = int(chunks_.size());
+      chunks_.push_back(std::make_shared<Chunk>());
+      chunks_.back()->position = chunk;
+      chunks_.back()->owner    = owner_.get();
+      insertChunkTable(chunk, index);
+    }
+    else if (chunks_[index]->owner != owner_.get())
+    {
+      // 他の複製と共有しているかもしれないので、書き換える前に複製する
+      auto copied = std::make_shared<Chunk>(*chunks_[index]);
+      copied->owner  = owner_.get();
+      chunks_[index] = std::move(copied);
+    }
+    return chunks_[index]->cells[getCellIndex(pos)];
+  }
+
+  void insertChunkTable(const glm::ivec2& chunk, int index) noexcept
+  {
+    size_t mask = chunk_table_.size() - 1;
+    size_t i = hashChunk(chunk) & mask;
+    while (chunk_table_[i] >= 0) i = (i + 1) & mask;
+    chunk_table_[i] = index;
+  }
+
+  // 置ける場所の周囲の端情報の種類を数える
+  void addPattern(const BlankEdge& blank) noexcept
+  {
+    auto it = std::find_if(std::begin(blank_pattern_), std::end(blank_pattern_),
+                           [&blank](const BlankPattern& pattern)
+                           {
+                             return (pattern.blank.edge == blank.edge) && (pattern.blank.mask == blank.mask);
+                           });
+    if (it == std::end(blank_pattern_))
+    {
+      blank_pattern_.push_back({ blank, 1 });
+      return;
+    }
+    it->count += 1;
+  }
+
+  void removePattern(const BlankEdge& blank) noexcept
+  {
+    auto it = std::find_if(std::begin(blank_pattern_), std::end(blank_pattern_),
+                           [&blank](const BlankPattern& pattern)
+                           {
+                             return (pattern.blank.edge == blank.edge) && (pattern.blank.mask == blank.mask);
+                           });
+    assert(it != std::end(blank_pattern_));
+    it->count -= 1;
+    if (it->count == 0)
+    {
+      // TIPS 末尾と入れ替えて削除
+      *it = blank_pattern_.back();
+      blank_pattern_.pop_back();
+    }
+  }
+
+  // 置ける場所から取り除く
+  // TIPS 末尾と入れ替えて削除
+  void removeBlank(Cell& cell) noexcept
+  {
+    auto index = cell.blank;
+    blank_sum_ -= blank_[index];
+    removePattern(blank_edge_[index]);
+    const auto& last = blank_.back();
+    reserveCell(last).blank = index;
+    blank_[index]      = last;
+    blank_edge_[index] = blank_edge_.back();
+
+    blank_.pop_back();
+    blank_edge_.pop_back();
+    cell.blank = -1;
+  }
+
+  // removeBlankで取り除いた場所を元の並びに戻す
+  void restoreBlank(const glm::ivec2& pos, int index, const BlankEdge& blank_edge) noexcept
+  {
+    if (index < int(blank_.size()))
+    {
+      // 入れ替えた場所を末尾に戻す
+      reserveCell(blank_[index]).blank = int(blank_.size());
+      blank_.push_back(blank_[index]);
+      blank_edge_.push_back(blank_edge_[index]);
+      blank_[index]      = pos;
+      blank_edge_[index] = blank_edge;
+    }
+    else
+    {
+      blank_.push_back(pos);
+      blank_edge_.push_back(blank_edge);
+    }
+
+    reserveCell(pos).blank = index;
+    blank_sum_ += pos;
+    addPattern(blank_edge);
+  }
+
+  // 軸方向の単位ベクトル(EXTENT_NUMの偶数番目)
+  static glm::vec2 extentAxis(u_int i) noexcept
+  {
+    static const glm::vec2 axis[] = {
+      {  1,  0 },
+      {  0,  1 },
+      { -1,  0 },
+      {  0, -1 },
+    };
+    return axis[i / 2];
+  }
+
+  // 方向ごとの座標の値
+  static int extentValue(const glm::ivec2& pos, u_int i) noexcept
+  {
+    switch (i)
+    {
+    case 0: return  pos.x;
+    case 1: return  pos.x + pos.y;
+    case 2: return  pos.y;
+    case 3: return  pos.y - pos.x;
+    case 4: return -pos.x;
+    case 5: return -pos.x - pos.y;
+    case 6: return -pos.y;
+    default: return pos.x - pos.y;
+    }
+  }
+
+  // ４辺全てに同じ端の種類を並べる
+  static uint64_t bundleEdgeType(uint64_t edge) noexcept
+  {
+    return edge | (edge << 16) | (edge << 32) | (edge << 48);
+  }
+
+  // 空き升目に面した端の一覧を更新
+  void updateOpenEdge(int index) noexcept
+  {
+    static const glm::ivec2 offsets[] = {
+      {  0,  1 },
+      {  1,  0 },
+      {  0, -1 },
+      { -1,  0 },
+    };
+
+    const auto& status = panel_status_[index];
+    uint64_t open = 0;
+    for (u_int i = 0; i < 4; ++i)
+    {
+      if (getCell(status.position + offsets[i]).panel < 0) open |= uint64_t(Panel::EDGE_MASK) << (i * 16);
+    }
+
+    auto& slot = open_edge_slot_[index];
+    for (u_int i = 0; i < EDGE_NUM; ++i)
+    {
+      bool is_open = status.edge & open & bundleEdgeType(1 << i);
+      auto& list   = open_edge_index_[i];
+      if (is_open && slot[i] < 0)
+      {
+        slot[i] = int(list.size());
+        list.push_back(index);
+      }
+      else if (!is_open && slot[i] >= 0)
+      {
+        // TIPS 末尾と入れ替えて削除
+        open_edge_slot_[list.back()][i] = slot[i];
+        list[slot[i]] = list.back();
+        list.pop_back();
+        slot[i] = -1;
+      }
+    }
+  }
+
+  // 置いた順に並んだ添字の一覧をまとめて位置にする(重複は除く)
+  std::vector<glm::ivec2> mergeIndex(const std::vector<int>* const lists[], size_t num, size_t max_num) const noexcept
+  {
+    std::vector<glm::ivec2> positions;
+    size_t heads[ATTRIBUTE_NUM + EDGE_NUM] = {};
+    while (!max_num || positions.size() < max_num)
+    {
+      // 各一覧の先頭で一番若いもの
+      int index = -1;
+      for (size_t i = 0; i < num; ++i)
+      {
+        if (heads[i] == lists[i]->size()) continue;
+
+        auto v = (*lists[i])[heads[i]];
+        if (index < 0 || v < index) index = v;
+      }
+      if (index < 0) break;
+
+      positions.push_back(panel_pos_array_[index]);
+      for (size_t i = 0; i < num; ++i)
+      {
+        if (heads[i] < lists[i]->size() && (*lists[i])[heads[i]] == index) heads[i] += 1;
+      }
+    }
+    return positions;
+  }
+
+  // 確保した升目の塊と、塊の位置から探すハッシュ表
+  // NOTICE 塊は複製したFieldと共有する
+  std::vector<std::shared_ptr<Chunk>> chunks_;
+  std::vector<int> chunk_table_;
+  Owner owner_;
 
-private:
-  // TIPS 座標をマップのキーにしている
-  std::map<glm::ivec2, PanelStatus, LessVec<glm::ivec2>> panel_status_;
   // 置いた順序
+  std::vector<PanelStatus> panel_status_;
   std::vector<glm::ivec2> panel_pos_array_;
+
+  // 置ける場所
+  std::vector<glm::ivec2> blank_;
+  std::vector<BlankEdge> blank_edge_;
+  std::vector<BlankPattern> blank_pattern_;
+
+  // 属性と端の種類ごとのパネル(panel_status_の添字)
+  std::vector<int> attribute_index_[ATTRIBUTE_NUM];
+  std::vector<int> edge_index_[EDGE_NUM];
+  // 空き升目に面した端を持つパネルと、パネルごとの一覧内の位置
+  std::vector<int> open_edge_index_[EDGE_NUM];
+  std::vector<std::array<int, EDGE_NUM>> open_edge_slot_;
+
+  // 中心と範囲を求める用
+  glm::ivec2 panel_sum_ = glm::ivec2(0);
+  glm::ivec2 blank_sum_ = glm::ivec2(0);
+  std::array<int, EXTENT_NUM> panel_extent_ {{ INT_MIN, INT_MIN, INT_MIN, INT_MIN, INT_MIN, INT_MIN, INT_MIN, INT_MIN }};
 };
 
 }
@@ -6,11 +6,17 @@
 
 #include <random>
 #include <numeric>
+#include <ctime>
+#include <algorithm>
 #include <boost/noncopyable.hpp>
-#include <cinder/Rand.h>
-#include "Logic.hpp"
+#include "Simulator.hpp"
+#include "MoveLog.hpp"
+#include "GameRecord.hpp"
+#include "Persistence.hpp"
+#include "HintEngine.hpp"
 #include "CountExec.hpp"
 #include "TextCodec.hpp"
+#include "MappedFile.hpp"
 
 
 namespace ngs {
@@ -24,11 +30,15 @@ struct Game
     : params_(params),
       event_(event),
       panels_(panels),
+      seed_(createSeed(params)),
+      sim_(createRule(params), panels, seed_),
       initial_play_time_(params.getValueForKey<double>("play_time")),
       play_time_(initial_play_time_),
-      scores_(7, 0)
+      hint_enabled_(Json::getValue(params, "hint", false)),
+      hint_depth_(Json::getValue<u_int>(params, "hint_depth", 1))
   {
     DOUT << "Panel: " << panels_.size() << std::endl;
+    DOUT << "Seed: " << seed_ << std::endl;
 
     // 課金済みなら制限時間を伸ばす
     if (purchased)
@@ -37,10 +47,6 @@ struct Game
       initial_play_time_ = params.getValueForKey<double>("play_time_extend");
       play_time_         = initial_play_time_;
     }
-
-    // 乱数
-    std::random_device seed_gen;
-    engine_ = std::mt19937(seed_gen());
   }
 
   ~Game() = default;
@@ -51,6 +57,24 @@ struct Game
   {
     count_exec_.update(delta_time);
 
+    if (isPlaying())
+    {
+      // 記録用の経過時間
+      elapsed_time_ += delta_time;
+
+      // ヒントの探索が終わっていたら送信
+      HintEngine::Hint hint;
+      if (hint_enabled_ && hint_.poll(hint))
+      {
+        Arguments args{
+          { "field_pos", hint.position },
+          { "rotation",  hint.rotation },
+          { "score",     hint.score },
+        };
+        event_.signal("Game:Hint", args);
+      }
+    }
+
     if (isPlaying()
         && time_limited_
 #ifdef DEBUG
@@ -95,18 +119,30 @@ struct Game
   {
     // パネルを準備
     preparationPanel(tutorial);
-    if (tutorial)
+
+    // 無限モード(チュートリアルでは使わない)
+    bool endless = !tutorial && Json::getValue(params_, "endless", false);
+    sim_.setEndless(endless);
+
+    move_log_ = MoveLog(seed_, (tutorial ? MoveLog::TUTORIAL : 0) | (endless ? MoveLog::ENDLESS : 0));
+    if (tutorial || endless)
     {
       // 制限時間無し
       invalidTimeLimit();
     }
+
+    // 一手戻す(チュートリアルでは常に使える)
+    sim_.setUndoEnabled(tutorial || Json::getValue(params_, "undo", false));
+    redo_moves_.clear();
   }
 
   // 本編準備
   void putFirstPanel() noexcept
   {
     // 最初のパネルを設置
-    putPanel(start_panel_, { 0, 0 }, ci::randInt(4), true);
+    auto rotation = sim_.putFirstPanel();
+    move_log_.record(sim_.getStartPanel(), rotation, { 0, 0 }, 0);
+    signalPutPanel(sim_.getStartPanel(), { 0, 0 }, rotation, true);
     // 次のパネルを決めて、置ける場所も探す
     getNextPanel();
   }
@@ -122,25 +158,26 @@ struct Game
   void endPlay() noexcept
   {
     finished = true;
+    hint_.cancel();
     calcResults();
 
     Arguments args{
-      { "scores",        scores_ },
+      { "scores",        sim_.getScores() },
       { "total_score",   total_score },
       { "total_ranking", total_ranking },
-      { "total_panels",  total_panels },
-      { "no_panels",     waiting_panels.empty() },
-      
+      { "total_panels",  sim_.total_panels },
+      { "no_panels",     sim_.waiting_panels.empty() },
+
       { "panel_turned_times", panel_turned_times_ },
       { "panel_moved_times",  panel_moved_times_ },
 
-      { "max_forest", max_forest_ },
-      { "max_path",   max_path_ },
+      { "max_forest", sim_.max_forest },
+      { "max_path",   sim_.max_path },
 
-      { "completed_forest", &completed_forests },
-      { "completed_path",   &completed_path },
+      { "completed_forest", &sim_.completed_forests },
+      { "completed_path",   &sim_.completed_path },
 
-      { "tutorial", is_tutorial_ },
+      { "tutorial", sim_.isTutorial() },
     };
     event_.signal("Game:Finish", args);
     
@@ -151,6 +188,7 @@ struct Game
   void abortPlay() noexcept
   {
     finished = true;
+    hint_.cancel();
   }
 
 
@@ -164,29 +202,18 @@ struct Game
   // パネルが置けるか調べる
   bool canPutToBlank(const glm::ivec2& field_pos) const noexcept
   {
-    bool can_put = false;
-    bool blank = std::any_of(std::begin(blank_), std::end(blank_),
-                    [&field_pos](const auto& it)
-                    {
-                      return it == field_pos;
-                    });
-    if (blank)
-    {
-      can_put = canPutPanel(panels_[hand_panel], field_pos, hand_rotation, field);
-    }
-
-    return can_put;
+    return sim_.canPutHandPanel(field_pos, sim_.hand_rotation);
   }
 
   // そこにblankがあるか？
   bool isBlank(const glm::ivec2& field_pos) const noexcept
   {
-    return std::find(std::begin(blank_), std::end(blank_), field_pos) != std::end(blank_);
+    return sim_.getField().isBlank(field_pos);
   }
 
   bool isPanel(const glm::ivec2& field_pos) const
   {
-    return field.existsPanel(field_pos);
+    return sim_.getField().existsPanel(field_pos);
   }
 
   // 操作
@@ -195,119 +222,123 @@ struct Game
     // プレイ中でなければ置けない
     if (!isPlaying()) return;
 
-    // パネルを追加してイベント送信
-    total_panels += 1;
-    putPanel(hand_panel, field_pos, hand_rotation);
+    // 手持ちが変わるのでヒントは無効
+    hint_.cancel();
 
-    // 状況チェック
-    checkFieldStatus(field_pos);
+    // 新しく置いたらやり直しはできない
+    redo_moves_.clear();
 
-    // 新しいパネル
-    if (!getNextPanel())
+    putPanel(field_pos);
+  }
+
+  // 一手戻す
+  bool canUndo() const noexcept
+  {
+    return isPlaying() && sim_.canUndo();
+  }
+
+  void undo() noexcept
+  {
+    if (!canUndo()) return;
+
+    hint_.cancel();
+
+    // NOTICE 手持ちパネルは置いた時の回転に戻る
+    auto pos = sim_.undo();
+    move_log_.cancel();
+    redo_moves_.push_back({ pos, sim_.hand_rotation });
+
+    Arguments args{
+      { "field_pos",    pos },
+      { "panel",        sim_.hand_panel },
+      { "rotation",     sim_.hand_rotation },
+      { "total_panels", sim_.total_panels },
+      { "remain_panel", u_int(sim_.waiting_panels.size()) },
+      { "scores",       sim_.getScores() },
+    };
+    event_.signal("Game:Undo", args);
+
+    if (hint_enabled_)
     {
-      // 全パネルを使い切った
-      DOUT << "End of panels." << std::endl;
-      endPlay();
+      hint_.request(std::make_shared<const Simulator>(sim_), hint_depth_);
     }
   }
 
-  // 状況チェック
-  void checkFieldStatus(const glm::ivec2& field_pos)
+  // 戻した手をやり直す
+  bool canRedo() const noexcept
   {
-    bool update_score = false;
-    {
-      // 森完成チェック
-      auto completed = isCompleteAttribute(Panel::FOREST, field_pos, field, panels_);
-      if (!completed.empty())
-      {
-        // 得点
-        DOUT << "Forest: " << completed.size() << '\n';
-        u_int deep_num = 0;
-        for (const auto& comp : completed)
-        {
-          // 深い森
-          auto deep = countDeepForest(comp, field, panels_);
-          deep_num += deep;
-          deep_forest.push_back(deep);
+    return isPlaying() && !redo_moves_.empty();
+  }
 
-          DOUT << " Point: " << comp.size() << '\n';
-          DOUT << "  Deep: " << deep << '\n';
-        }
+  void redo() noexcept
+  {
+    if (!canRedo()) return;
 
-        // 最大森
-        auto it = std::max_element(std::begin(completed), std::end(completed),
-                                   [](const auto& a, const auto& b)
-                                   {
-                                     return a.size() < b.size();
-                                   });
-        max_forest_ = u_int(it->size());
+    hint_.cancel();
 
-        DOUT << "Total Deep: " << deep_num << '\n';
-        DOUT << "Max forest: " << max_forest_ << '\n';
-        DOUT << std::endl;
+    auto move = redo_moves_.back();
+    redo_moves_.pop_back();
 
-        appendContainer(completed, completed_forests);
+    sim_.hand_rotation = move.second;
+    putPanel(move.first);
+  }
 
-        Arguments args{
-          { "completed", completed }
-        };
-        event_.signal("Game:completed_forests", args);
+  // 状況チェック
+  void checkFieldStatus(const glm::ivec2& field_pos)
+  {
+    auto completed = sim_.checkCompleted(field_pos);
 
-        update_score = true;
-      }
-    }
+    if (!completed.forests.empty())
     {
-      // 道完成チェック
-      auto completed = isCompleteAttribute(Panel::PATH, field_pos, field, panels_);
-      if (!completed.empty())
+      // 得点
+      DOUT << "Forest: " << completed.forests.size() << '\n';
+      u_int deep_num = 0;
+      for (size_t i = 0; i < completed.forests.size(); ++i)
       {
-        DOUT << "  Path: " << completed.size() << '\n';
-        auto it = std::max_element(std::begin(completed), std::end(completed),
-                                   [](const auto& a, const auto& b)
-                                   {
-                                     return a.size() < b.size();
-                                   });
-        max_path_ = int(it->size());
+        auto deep = completed.deep_forests[i];
+        deep_num += deep;
 
-        DOUT << "Max path: " << max_path_;
-        DOUT << std::endl;
+        DOUT << " Point: " << completed.forests[i].size() << '\n';
+        DOUT << "  Deep: " << deep << '\n';
+      }
+      DOUT << "Total Deep: " << deep_num << '\n';
+      DOUT << "Max forest: " << sim_.max_forest << '\n';
+      DOUT << std::endl;
 
-        appendContainer(completed, completed_path);
+      Arguments args{
+        { "completed", completed.forests }
+      };
+      event_.signal("Game:completed_forests", args);
+    }
 
-        Arguments args{
-          { "completed", completed }
-        };
-        event_.signal("Game:completed_path", args);
+    if (!completed.paths.empty())
+    {
+      DOUT << "  Path: " << completed.paths.size() << '\n';
+      DOUT << "Max path: " << sim_.max_path;
+      DOUT << std::endl;
 
-        update_score = true;
-      }
+      Arguments args{
+        { "completed", completed.paths }
+      };
+      event_.signal("Game:completed_path", args);
     }
+
+    if (!completed.churches.empty())
     {
-      // 教会完成チェック
-      auto completed = isCompleteChurch(field_pos, field, panels_);
-      if (!completed.empty())
-      {
-        // 得点
-        DOUT << "Church: " << completed.size() << std::endl;
-              
-        appendContainer(completed, completed_church);
-        
-        Arguments args{
-          { "completed", completed }
-        };
-        event_.signal("Game:completed_church", args);
+      // 得点
+      DOUT << "Church: " << completed.churches.size() << std::endl;
 
-        update_score = true;
-      }
+      Arguments args{
+        { "completed", completed.churches }
+      };
+      event_.signal("Game:completed_church", args);
     }
 
     // スコア更新
-    if (update_score)
+    if (!completed.empty())
     {
-      updateScores();
-      
       Arguments args{
-        { "scores", scores_ },
+        { "scores", sim_.getScores() },
       };
       event_.signal("Game:UpdateScores", args);
     }
@@ -315,7 +346,8 @@ struct Game
 
   void rotationHandPanel() noexcept
   {
-    hand_rotation = (hand_rotation + 1) % 4;
+    hint_.cancel();
+    sim_.rotationHandPanel();
     panel_turned_times_ += 1;
   }
 
@@ -327,66 +359,52 @@ struct Game
   // 手持ちパネル情報
   u_int getHandPanel() const noexcept
   {
-    return hand_panel;
+    return sim_.hand_panel;
   }
 
   u_int getHandRotation() const noexcept
   {
-    return hand_rotation;
+    return sim_.hand_rotation;
   }
 
   // 手持ちパネルのエッジ情報
   uint64_t getHandPanelEdge() const noexcept
   {
-    const auto p = panels_[hand_panel];
-    return p.getRotatedEdgeValue(hand_rotation);
+    const auto& p = panels_[sim_.hand_panel];
+    return p.getRotatedEdgeValue(sim_.hand_rotation);
   }
 
 
   // 配置可能な場所
   const std::vector<glm::ivec2>& getBlankPositions() const noexcept
   {
-    return blank_;
+    return sim_.getField().getBlankPositions();
   }
 
   // パネルを置く場所を適当に決める
   glm::ivec2 getNextPanelPosition(const glm::ivec2& put_pos) noexcept
   {
-    auto positions = getBlankPositions();
-    // 適当に並び替える
-    std::shuffle(std::begin(positions), std::end(positions), engine_);
-
-    // 置いた場所から一番距離の近い場所を選ぶ
-    auto it = std::min_element(std::begin(positions), std::end(positions),
-                               [put_pos](const glm::ivec2& a, const glm::ivec2& b) noexcept
-                               {
-                                 // FIXME 整数型のベクトルだとdistance2とかdotとかが使えない
-                                 auto da = put_pos - a;
-                                 auto db = put_pos - b;
-
-                                 return (da.x * da.x + da.y * da.y) < (db.x * db.x + db.y * db.y);
-                               });
-
-    return *it;
+    return sim_.getNextPanelPosition(put_pos);
   }
 
-  // 指定属性のパネルを探す
-  std::tuple<bool, glm::ivec2, int> searchAttribute(u_int attribute, u_int edge) const
+  // 乱数の種
+  uint32_t getSeed() const noexcept
   {
-    uint64_t e = edge;
-    uint64_t edge_bundled = e | (e << 16) | (e << 32) | (e << 48);
-
-    const auto& panel_positions = field.getPanelPositions();
-    auto it = std::find_if(std::begin(panel_positions), std::end(panel_positions),
-                           [this, attribute, edge_bundled](const glm::ivec2& pos)
-                           {
-                             const auto& status = field.getPanelStatus(pos);
-                             const auto& panel  = panels_[status.number];
+    return seed_;
+  }
 
-                             return (panel.getAttribute() & attribute) || (edge_bundled & status.edge);
-                           });
+  // パネルを置いた記録
+  const MoveLog& getMoveLog() const noexcept
+  {
+    return move_log_;
+  }
 
-    if (it == std::end(panel_positions))
+  // 指定属性のパネルを探す
+  std::tuple<bool, glm::ivec2, int> searchAttribute(u_int attribute, u_int edge) const
+  {
+    const auto& field = sim_.getField();
+    auto positions = field.searchPanels(attribute, edge, 1);
+    if (positions.empty())
     {
       return { false, glm::ivec2(0), 0 };
     }
@@ -395,7 +413,8 @@ struct Game
     int rotate = 0;
     if (edge)
     {
-      const auto& status = field.getPanelStatus(*it);
+      uint64_t e = edge;
+      const auto& status = field.getPanelStatus(positions[0]);
       auto rotated_edge  = status.edge;
 
       for ( ; rotate < 4; ++rotate)
@@ -404,84 +423,92 @@ struct Game
         {
           break;
         }
-        // NOTICE 事前に定義した変数を変更している
         e <<= 16;
       }
     }
 
-    return { true, *it, rotate };
+    return { true, positions[0], rotate };
   }
 
   // 指定属性のパネルを探す
   std::vector<glm::ivec2> searchPanels(u_int attribute) const
   {
-    const auto& panel_positions = field.getPanelPositions();
-
-    std::vector<glm::ivec2> positions;
-    for (const auto& p : panel_positions)
-    {
-      const auto& status = field.getPanelStatus(p);
-      const auto& panel  = panels_[status.number];
-      if (panel.getAttribute() & attribute) positions.push_back(p);
-    }
-
-    return positions;
+    return sim_.getField().searchPanels(attribute, 0);
   }
 
   // こちらはEdge版
   std::vector<glm::ivec2> searchPanelsAtEdge(u_int attribute) const
   {
-    const auto& panel_positions = field.getPanelPositions();
-    uint64_t e = attribute;
-    uint64_t edge_bundled = e | (e << 16) | (e << 32) | (e << 48);
-
-    std::vector<glm::ivec2> positions;
-    for (const auto& p : panel_positions)
-    {
-      const auto& status = field.getPanelStatus(p);
-      if (status.edge & edge_bundled) positions.push_back(p);
-    }
+    return sim_.getField().searchPanels(0, attribute);
+  }
 
-    return positions;
+  // 空き升目に面したEdgeを持つパネル
+  std::vector<glm::ivec2> searchPanelsAtOpenEdge(u_int attribute) const
+  {
+    return sim_.getField().searchOpenEdgePanels(attribute);
   }
 
   // フィールド上のパネルのEdge状態を取得(回転込み)
   uint64_t getPanelEdge(const glm::ivec2& pos) const
   {
-    const auto& status = field.getPanelStatus(pos);
+    const auto& status = sim_.getField().getPanelStatus(pos);
     return status.edge;
   }
 
 
   // 保存
-  void save(const std::string& name) const noexcept
+  // NOTICE 書き出しは別スレッドで行う
+  void save(const std::string& name, Persistence& persistence) const noexcept
   {
-    ci::JsonTree save_data;
-
-    save_data.addChild(ci::JsonTree("hand_panel", hand_panel))
-             .addChild(ci::JsonTree("hand_rotation", hand_rotation))
-             .addChild(Json::createArray("waiting_panels", waiting_panels))
-             .addChild(field.serialize())
-             .addChild(ci::JsonTree("play_time", play_time_))
-             .addChild(Json::createVecVecArray("completed_forests", completed_forests))
-             .addChild(Json::createArray("deep_forest", deep_forest))
-             .addChild(Json::createVecVecArray("completed_path", completed_path))
-             .addChild(Json::createVecArray("completed_church", completed_church))
-             .addChild(ci::JsonTree("panel_turned_times", panel_turned_times_))
-             .addChild(ci::JsonTree("panel_moved_times", panel_moved_times_))
-             .addChild(ci::JsonTree("tutorial", is_tutorial_))
-             ;
-
-
-#if defined(OBFUSCATION_GAME_RECORD)
-    TextCodec::write((getDocumentPath() / name).string(), save_data.serialize());
-#else
-    save_data.write(getDocumentPath() / name);
-#endif
+    GameRecord record;
+    record.flags = GameRecord::SCORED
+                 | (sim_.isTutorial() ? GameRecord::TUTORIAL : 0)
+                 | (sim_.isEndless()  ? GameRecord::ENDLESS  : 0);
+
+    record.total_score        = total_score;
+    record.total_ranking      = total_ranking;
+    record.play_time          = play_time_;
+    record.panel_turned_times = panel_turned_times_;
+    record.panel_moved_times  = panel_moved_times_;
+    record.hand_panel         = sim_.hand_panel;
+    record.hand_rotation      = sim_.hand_rotation;
+
+    for (const auto& status : sim_.getField().enumeratePanels())
+    {
+      record.panels.push_back({ status.number, status.position, status.rotation });
+    }
+    record.waiting_panels    = sim_.waiting_panels;
+    record.completed_forests = sim_.completed_forests;
+    record.deep_forest       = sim_.deep_forest;
+    record.completed_path    = sim_.completed_path;
+    record.completed_church  = sim_.completed_church;
+    record.move_log          = move_log_.serialize();
+
+    std::string data;
+    if (!record.serialize(data))
+    {
+      DOUT << "Game record can't serialize." << std::endl;
+      return;
+    }
+    persistence.write(getDocumentPath() / name, std::move(data));
 
     DOUT << "Game saved: " << name << std::endl;
   }
 
+  // 記録を読む
+  // TIPS ファイルの内容を直接読む(大きいファイルはマップする)
+  // NOTICE JSONで保存していた頃の記録も読む(その時はlegacyがtrue)
+  //        パネル番号や置いた場所がおかしければ壊れている(panel_num: パネルの総数)
+  static bool readRecord(const ci::fs::path& path, size_t panel_num, GameRecord& record, bool& legacy)
+  {
+    MappedFile file(path.string());
+    if (!file.isValid()) return false;
+
+    legacy = !GameRecord::isRecord(file.data(), file.size());
+    return legacy ? readJsonRecord(file.data(), file.size(), panel_num, record)
+                  : record.deserialize(file.data(), file.size(), panel_num);
+  }
+
   // NOTE pathはfull path
   void load(const ci::fs::path& path, double delay = 0.0)
   {
@@ -496,65 +523,68 @@ struct Game
       return;
     }
 
-    ci::JsonTree json;
-#if defined (OBFUSCATION_GAME_RECORD)
-    auto text = TextCodec::load(path.string());
-    try
-    {
-      json = ci::JsonTree(text);
-    }
-    catch (ci::JsonTree::ExcJsonParserError&)
+    GameRecord record;
+    bool legacy;
+    if (!readRecord(path, panels_.size(), record, legacy))
     {
       DOUT << "Game record broken." << std::endl;
       return;
     }
-#else
-    try
-    {
-      json = ci::JsonTree(ci::loadFile(path));
-    }
-    catch (ci::JsonTree::ExcJsonParserError&)
+
+    // NOTICE JSONで保存していた頃の記録は、次からバイナリで読めるように書き換える(アセットは除く)
+    //        壊れた記録は書き換えない(readRecordで確かめている)
+    if (legacy && path.parent_path() == getDocumentPath())
     {
-      DOUT << "Game record broken." << std::endl;
-      return;
+      writeRecord(path, record);
+      DOUT << "Game record migrated: " << path.filename() << std::endl;
     }
-#endif
 
     count_exec_.clear();
 
-    hand_panel     = json.getValueForKey<int>("hand_panel");
-    hand_rotation  = json.getValueForKey<u_int>("hand_rotation");
-    waiting_panels = Json::getArray<int>(json["waiting_panels"]);
-    field          = Field(json["field"]);
-    play_time_     = json.getValueForKey<double>("play_time");
-    
-    completed_forests = Json::getVecVecArray<glm::ivec2>(json["completed_forests"]);
-    deep_forest       = Json::getArray<u_int>(json["deep_forest"]);
-    completed_path    = Json::getVecVecArray<glm::ivec2>(json["completed_path"]);
-    completed_church  = Json::getVecArray<glm::ivec2>(json["completed_church"]);
+    sim_.hand_panel     = record.hand_panel;
+    sim_.hand_rotation  = record.hand_rotation;
+    sim_.waiting_panels = record.waiting_panels;
+    sim_.restoreField(createField(record, panels_));
+    play_time_          = record.play_time;
 
-    panel_turned_times_ = json.getValueForKey<u_int>("panel_turned_times");
-    panel_moved_times_  = json.getValueForKey<u_int>("panel_moved_times");
+    sim_.completed_forests = record.completed_forests;
+    sim_.deep_forest       = record.deep_forest;
+    sim_.completed_path    = record.completed_path;
+    sim_.completed_church  = record.completed_church;
 
-    is_tutorial_ = Json::getValue(json, "tutorial", false);
+    panel_turned_times_ = record.panel_turned_times;
+    panel_moved_times_  = record.panel_moved_times;
+
+    sim_.setTutorial(record.flags & GameRecord::TUTORIAL);
+    sim_.setEndless(record.flags & GameRecord::ENDLESS);
+
+    // NOTICE 古い記録には無い
+    move_log_ = MoveLog();
+    if (!record.move_log.empty())
+    {
+      if (!move_log_.deserialize(record.move_log))
+      {
+        DOUT << "Move log broken." << std::endl;
+      }
+    }
 
     // 完成したパネル群
     std::set<glm::ivec2, LessVec<glm::ivec2>> completed_panels;
-    for (const auto& v : completed_forests)
+    for (const auto& v : sim_.completed_forests)
     {
       for (const auto& p : v)
       {
         completed_panels.insert(p);
       }
     }
-    for (const auto& v : completed_path)
+    for (const auto& v : sim_.completed_path)
     {
       for (const auto& p : v)
       {
         completed_panels.insert(p);
       }
     }
-    for (const auto& p : completed_church)
+    for (const auto& p : sim_.completed_church)
     {
       completed_panels.insert(p);
     }
@@ -562,7 +592,7 @@ struct Game
     double at_time       = params_.getValueForKey<double>("replay.delay") + delay;
     double interval_time = params_.getValueForKey<double>("replay.interval");
 
-    auto panels = field.enumeratePanels();
+    const auto& panels = sim_.getField().enumeratePanels();
     for (const auto& status : panels)
     {
       bool comp = completed_panels.count(status.position);
@@ -582,10 +612,10 @@ struct Game
       at_time += interval_time;;
     }
     // NOTICE 最初に置かれているパネルは除く
-    total_panels = u_int(panels.size()) - 1;
+    sim_.total_panels = u_int(panels.size()) - 1;
 
     // スコア情報は時間差で送信
-    updateScores();
+    sim_.updateScores();
     calcResults();
     sendScores();
   }
@@ -598,33 +628,13 @@ struct Game
 
 
   // Fieldの中心位置と広さを計算
+  // TIPS Fieldがパネルを置くたびに範囲を更新している
   std::pair<glm::vec3, float> getFieldCenterAndDistance(bool blank = true) const noexcept
   {
-    std::vector<glm::vec3> points;
-    const auto& positions = blank ? getBlankPositions() : field.getPanelPositions();
-    for (const auto& p : positions)
-    {
-      // Panelの４隅の座標を加える
-      points.emplace_back(p.x - 0.5, 0.0f, p.y - 0.5);
-      points.emplace_back(p.x + 0.5, 0.0f, p.y - 0.5);
-      points.emplace_back(p.x - 0.5, 0.0f, p.y + 0.5);
-      points.emplace_back(p.x + 0.5, 0.0f, p.y + 0.5);
-    }
-
-    // 登録した点の平均値→注視点
-    auto center = std::accumulate(std::begin(points), std::end(points), glm::vec3()) / float(points.size());
+    auto result = sim_.getField().getCenterAndRadius(blank);
+    const auto& center = result.first;
 
-    // 中心から一番遠い座標から距離を決める
-    auto it = std::max_element(std::begin(points), std::end(points),
-                               [center](const glm::vec3& a, const glm::vec3& b) noexcept
-                               {
-                                 auto d1 = glm::distance2(a, center);
-                                 auto d2 = glm::distance2(b, center);
-                                 return d1 < d2;
-                               });
-    auto d = glm::distance(*it, center);
-
-    return { center, d };
+    return { glm::vec3(center.x, 0.0f, center.y), result.second };
   }
 
   // UI更新
@@ -645,6 +655,9 @@ struct Game
   // 強制的に次のカード
   void forceNextHandPanel() noexcept
   {
+    // NOTICE 取り消しの記録と食い違うので消す
+    sim_.setUndoEnabled(sim_.isUndoEnabled());
+    redo_moves_.clear();
     if (!getNextPanel())
     {
       // 全パネルを使い切った
@@ -655,7 +668,10 @@ struct Game
 
   void testPutPanel(const glm::ivec2& field_pos, int panel, u_int rotation)
   {
-    putPanel(panel, field_pos, rotation);
+    sim_.setUndoEnabled(sim_.isUndoEnabled());
+    redo_moves_.clear();
+    sim_.putPanel(panel, field_pos, rotation);
+    signalPutPanel(panel, field_pos, rotation);
     checkFieldStatus(field_pos);
   }
 
@@ -678,6 +694,7 @@ struct Game
   // 手持ちのパネルを変更
   void changePanelForced(int next) noexcept
   {
+    auto& hand_panel = sim_.hand_panel;
     hand_panel += next;
     if (hand_panel < 0)
     {
@@ -705,9 +722,9 @@ struct Game
     for (const auto& ofs : offsets)
     {
       auto p = pos + ofs;
-      if (!field.existsPanel(p)) continue;
+      if (!sim_.getField().existsPanel(p)) continue;
 
-      const auto& panel_status = field.getPanelStatus(p);
+      const auto& panel_status = sim_.getField().getPanelStatus(p);
       around_panels.emplace(p, panel_status);
     }
 
@@ -722,209 +739,236 @@ struct Game
 
 
 private:
-  // フィールドに置くパネルの準備
-  // tutorial_level >= 0 でチュートリアル用の配置
-  void preparationPanel(bool tutorial)
+  // 乱数の種
+  static uint32_t createSeed(const ci::JsonTree& params)
   {
-    if (tutorial)
+#if defined (DEBUG)
+    // テスト用に固定
+    auto seed = Json::getValue<uint32_t>(params, "seed", 0);
+    if (seed > 0) return seed;
+#endif
+    std::random_device seed_gen;
+    return seed_gen();
+  }
+
+  // 16進数文字列→バイナリ
+  static std::string fromHex(const std::string& text)
+  {
+    auto value = [](char c)
+                 {
+                   return (c <= '9') ? c - '0' : c - 'a' + 10;
+                 };
+
+    std::string data;
+    data.reserve(text.size() / 2);
+    for (size_t i = 0; i + 1 < text.size(); i += 2)
     {
-      // チュートリアル用準備
-      waiting_panels = Json::getArray<int>(params_["tutorial"]);
-      // NOTICE 順番はあらかじめ用意されている
-      start_panel_ = waiting_panels[0];
-      waiting_panels.erase(std::begin(waiting_panels));
-      // FIXME Tutorialであることを覚えたくない
-      is_tutorial_ = true;
+      data.push_back(char((value(text[i]) << 4) | value(text[i + 1])));
     }
-    else
-    {
-      // パネルを通し番号で用意
-      waiting_panels.resize(panels_.size());
-      std::iota(std::begin(waiting_panels), std::end(waiting_panels), 0);
-
-      // 開始パネルを探す
-      std::vector<int> start_panels;
-      for (int i = 0; i < panels_.size(); ++i)
-      {
-        if (panels_[i].getAttribute() & Panel::START)
-        {
-          start_panels.push_back(i);
-        }
-      }
-      assert(!start_panels.empty());
-
-      if (start_panels.size() > 1)
-      {
-        // 開始パネルが何枚かある時はシャッフル
-        std::shuffle(std::begin(start_panels), std::end(start_panels), engine_);
-      }
-      start_panel_ = start_panels[0];
-
-      {
-        // 最初に置くパネルを取り除いてからシャッフル
-        auto it = std::find(std::begin(waiting_panels), std::end(waiting_panels), start_panel_);
-        assert(it != std::end(waiting_panels));
-        waiting_panels.erase(it);
+    return data;
+  }
 
-        std::shuffle(std::begin(waiting_panels), std::end(waiting_panels), engine_);
-      }
-    }
+  // 得点計算用のパラメーター
+  static Rule createRule(const ci::JsonTree& params)
+  {
+    Rule rule {
+      Json::getVec<glm::vec2>(params["panel_rate"]),
+      Json::getArray<float>(params["score_rates"]),
+      Json::getVec<glm::vec3>(params["ranking_rate"]),
+      params.getValueForKey<float>("perfect_score_rate"),
+    };
+    return rule;
+  }
 
-#if defined (DEBUG)
-    auto force_panel = params_.getValueForKey<int>("force_panel");
-    if (force_panel > 0)
+  // 記録からFieldを作る
+  // TIPS 辺の情報はパネル番号と向きから求める
+  static Field createField(const GameRecord& record, const std::vector<Panel>& panels)
+  {
+    Field field;
+    for (const auto& p : record.panels)
     {
-      // パネル枚数を強制的に変更
-      waiting_panels.resize(force_panel);
+      const auto& panel = panels[p.number];
+      field.addPanel(p.number, p.position, p.rotation, panel.getRotatedEdgeValue(p.rotation), panel.getAttribute());
     }
-#endif
+    return field;
   }
 
-  // 制限時間無し
-  void invalidTimeLimit() noexcept
+  static void writeRecord(const ci::fs::path& path, const GameRecord& record)
   {
-    time_limited_ = false;
+    std::string data;
+    if (!record.serialize(data))
+    {
+      DOUT << "Game record can't serialize." << std::endl;
+      return;
+    }
+
+    Persistence::writeFile(path, data);
   }
 
-  bool getNextPanel() noexcept
+  // JSONで保存していた頃の記録を読む
+  // NOTICE 難読化されていてもいなくても読む
+  static bool readJsonRecord(const char* data, size_t size, size_t panel_num, GameRecord& record)
   {
-    if (waiting_panels.empty()) return false;
-
-    // 先頭から順に置けるかどうか調べる
-    size_t i;
-    for (i = 0; i < waiting_panels.size(); ++i)
+    const std::string blank(" \t\r\n\xef\xbb\xbf");
+    auto pos = std::find_if(data, data + size,
+                            [&blank](char c)
+                            {
+                              return blank.find(c) == std::string::npos;
+                            });
+    if (pos == data + size) return false;
+
+    std::string text;
+    if (*pos == '{')
     {
-      if (canPanelPutField(panels_[waiting_panels[i]], blank_, field)) break;
+      text.assign(data, size);
+    }
+    else if (!TextCodec::decode(data, size, text))
+    {
+      return false;
     }
 
-    if (i == waiting_panels.size())
+    ci::JsonTree json;
+    try
+    {
+      json = ci::JsonTree(text);
+    }
+    catch (ci::JsonTree::ExcJsonParserError&)
     {
-      // 全く置けない(積んだ)
       return false;
     }
 
-    hand_panel    = waiting_panels[i];
-    hand_rotation = ci::randInt(4);
+    record.flags = (Json::getValue(json, "tutorial", false) ? GameRecord::TUTORIAL : 0)
+                 | (Json::getValue(json, "endless", false)  ? GameRecord::ENDLESS  : 0);
+    // NOTICE 古い記録には得点が無い
+    if (json.hasChild("total_score"))
+    {
+      record.flags        |= GameRecord::SCORED;
+      record.total_score   = json.getValueForKey<u_int>("total_score");
+      record.total_ranking = json.getValueForKey<u_int>("total_ranking");
+    }
 
-    // コンテナから削除
-    waiting_panels.erase(std::begin(waiting_panels) + i);
+    record.hand_panel         = json.getValueForKey<int>("hand_panel");
+    record.hand_rotation      = json.getValueForKey<u_int>("hand_rotation");
+    record.waiting_panels     = Json::getArray<int>(json["waiting_panels"]);
+    record.play_time          = json.getValueForKey<double>("play_time");
+    record.panel_turned_times = json.getValueForKey<u_int>("panel_turned_times");
+    record.panel_moved_times  = json.getValueForKey<u_int>("panel_moved_times");
 
-    DOUT << "Next panel: " << hand_panel << "(index: " << i << ")" << std::endl;
+    for (const auto& obj : json["field"])
+    {
+      record.panels.push_back({ obj.getValueForKey<int>("number"),
+                                Json::getVec<glm::ivec2>(obj["pos"]),
+                                obj.getValueForKey<u_int>("rotation") & 3 });
+    }
 
-    return true;
-  }
+    record.completed_forests = Json::getVecVecArray<glm::ivec2>(json["completed_forests"]);
+    record.deep_forest       = Json::getArray<u_int>(json["deep_forest"]);
+    record.completed_path    = Json::getVecVecArray<glm::ivec2>(json["completed_path"]);
+    record.completed_church  = Json::getVecArray<glm::ivec2>(json["completed_church"]);
 
-  // 各種情報を収集
-  void fieldUpdate() noexcept
-  {
-    blank_ = field.searchBlank();
+    if (json.hasChild("move_log"))
+    {
+      record.move_log = fromHex(json.getValueForKey<std::string>("move_log"));
+    }
+
+    return record.validate(panel_num);
   }
 
-  // スコア更新
-  void updateScores() noexcept
+  // 日替わりの配り
+  // NOTICE dealerで選んだ配りをparams.jsonのdailyに並べておく
+  //        乱数の種だけ差し替えるので、MoveLogの再生はこれまで通り
+  void selectDailySeed()
   {
-    // FIXME MagicNumber
-    scores_[0] = int(completed_path.size());
-    scores_[1] = countTotalAttribute(completed_path, field, panels_);
-    scores_[2] = int(completed_forests.size());
-    scores_[3] = countTotalAttribute(completed_forests, field, panels_);
-    scores_[4] = int(std::count_if(std::begin(deep_forest), std::end(deep_forest),
-                                   [](int x) { return x > 0; }));
-    scores_[5] = countTown(completed_path, field, panels_);
-    scores_[6] = int(completed_church.size());
-  }
+    if (!Json::getValue(params_, "daily_challenge", false)) return;
+    if (!params_.hasChild("daily")) return;
 
+    const auto& daily = params_["daily"];
+    auto num = daily.getNumChildren();
+    if (num == 0) return;
 
-  void calcResults() noexcept
-  {
-    total_score   = calcTotalScore();
-    total_ranking = calcRanking(total_score);
+    // 日付(UTC)で選ぶ
+    auto day = size_t(std::time(nullptr) / (24 * 60 * 60));
+    seed_ = daily.getChild(day % num).getValueAtIndex<uint32_t>(0);
+    sim_.setSeed(seed_);
+
+    DOUT << "Daily: " << seed_ << std::endl;
   }
 
-  // 最終スコア
-  u_int calcTotalScore() const noexcept
+  // フィールドに置くパネルの準備
+  void preparationPanel(bool tutorial)
   {
-    // 道と森の計算用
-    auto panel_rate  = Json::getVec<glm::vec2>(params_["panel_rate"]);
-    auto score_rates = Json::getArray<float>(params_["score_rates"]);
-
-    float score = 0;
-
-    // 道の計算
-    // TIPS 長い道ほど指数関数的に得点が上がる
-    auto path_score = std::accumulate(std::begin(completed_path), std::end(completed_path),
-                                      0.0f,
-                                      [this, &panel_rate, &score_rates](auto value, const auto& path)
-                                      {
-                                        auto s = std::pow(float(path.size()), panel_rate.x) * panel_rate.y * score_rates[0];
-                                        DOUT << path.size() << " : " << s << std::endl;
-                                        return value + s;
-                                      });
-    DOUT << "Path: " << path_score << std::endl;
-    score += path_score;
-
-    // 森の計算
-    // TIPS 面積が大きいほど指数関数的に得点が上がる
-    float forest_score = 0;
-    size_t index = 0;
-    for (const auto& forest : completed_forests)
+    if (tutorial)
     {
-      auto count = forest.size() + deep_forest[index] * score_rates[2];
-      float s = std::pow(float(count), panel_rate.x) * panel_rate.y * score_rates[1];
-      forest_score += s;
-      DOUT << forest.size() << "(" << deep_forest[index] << ") : " << s << std::endl;
-
-      ++index;
+      // チュートリアル用準備
+      // NOTICE 順番はあらかじめ用意されている
+      sim_.preparationPanel(Json::getArray<int>(params_["tutorial"]));
     }
-    score += forest_score;
-    DOUT << "Forest: " << forest_score << std::endl;
-
-    // 深い森の数
-    // float df_score = scores_[4] * score_rates[2];
-    // score += df_score;
-    // DOUT << "Deep forest: " << df_score << std::endl;
-
-    // 街の数
-    float town_score = scores_[5] * score_rates[3];
-    score += town_score;
-    DOUT << "Town forest: " << town_score << std::endl;
-
-    // 教会
-    float church_score = scores_[6] * score_rates[4];
-    score += church_score;
-    DOUT << "Church: " << church_score << std::endl;
-
-    // パネル設置数
-    score += total_panels * score_rates[5];
-    DOUT << "Panels: " << score << std::endl;
-
-    // Perfect
-    if (waiting_panels.empty() && !is_tutorial_)
+    else
     {
-      DOUT << "perfect!!" << std::endl;
-      score *= params_.getValueForKey<float>("perfect_score_rate");
+      selectDailySeed();
+      sim_.preparationPanel();
     }
+
 #if defined (DEBUG)
-    // テスト用にスコアを上書き
-    score = Json::getValue(params_, "test_score", score);
+    auto force_panel = params_.getValueForKey<int>("force_panel");
+    if (force_panel > 0)
+    {
+      // パネル枚数を強制的に変更
+      sim_.resizePanels(force_panel);
+    }
 #endif
-    return score;
   }
 
-  // ランキングを決める
-  u_int calcRanking(int score) const noexcept
+  // 制限時間無し
+  void invalidTimeLimit() noexcept
+  {
+    time_limited_ = false;
+  }
+
+  // 手持ちのパネルを置いて次のパネルを配る
+  void putPanel(const glm::ivec2& field_pos) noexcept
+  {
+    // パネルを追加してイベント送信
+    auto panel    = sim_.hand_panel;
+    auto rotation = sim_.hand_rotation;
+    sim_.putHandPanel(field_pos);
+    move_log_.record(panel, rotation, field_pos, u_int(elapsed_time_ * 1000.0));
+    signalPutPanel(panel, field_pos, rotation);
+
+    // 状況チェック
+    checkFieldStatus(field_pos);
+
+    // 新しいパネル
+    if (!getNextPanel())
+    {
+      // 全パネルを使い切った
+      DOUT << "End of panels." << std::endl;
+      endPlay();
+    }
+  }
+
+  bool getNextPanel() noexcept
   {
-    auto rate = Json::getVec<glm::vec3>(params_["ranking_rate"]);
-    u_int rank;
-    // FIXME Magic Number
-    for (rank = 0; rank < 9; ++rank)
+    if (!sim_.getNextPanel()) return false;
+
+    DOUT << "Next panel: " << sim_.hand_panel << std::endl;
+
+    if (hint_enabled_)
     {
-      // ランク後半ほど高得点が必要になる
-      int s = std::pow(rate.x, rank * rate.y) * rate.z;
-      if (score < s) break;
+      // 盤面の複製を渡して別スレッドで探索
+      hint_.request(std::make_shared<const Simulator>(sim_), hint_depth_);
     }
+    return true;
+  }
 
-    return rank;
+  void calcResults() noexcept
+  {
+    total_score = sim_.calcTotalScore();
+#if defined (DEBUG)
+    // テスト用にスコアを上書き
+    total_score = Json::getValue(params_, "test_score", total_score);
+#endif
+    total_ranking = sim_.calcRanking(total_score);
   }
 
   // スコアを送信
@@ -935,47 +979,38 @@ private:
                     [this]() noexcept
                     {
                       Arguments args{
-                        { "scores",        scores_ },
+                        { "scores",        sim_.getScores() },
                         { "total_score",   total_score },
                         { "total_ranking", total_ranking },
-                        { "total_panels",  total_panels },
+                        { "total_panels",  sim_.total_panels },
 
-                        { "completed_forest", &completed_forests },
-                        { "completed_path",   &completed_path },
+                        { "completed_forest", &sim_.completed_forests },
+                        { "completed_path",   &sim_.completed_path },
 
                         { "panel_turned_times", panel_turned_times_ },
                         { "panel_moved_times",  panel_moved_times_ },
 
-                        { "perfect", waiting_panels.empty() },
+                        { "perfect", sim_.waiting_panels.empty() },
 
-                        { "tutorial", is_tutorial_ },
+                        { "tutorial", sim_.isTutorial() },
                       };
                       event_.signal("Ranking:UpdateScores", args);
                     });
   }
 
 
-  // パネルを追加してイベント送信
-  void putPanel(int panel, const glm::ivec2& pos, u_int rotation, bool first = false) noexcept
+  // パネルを置いたイベント送信
+  void signalPutPanel(int panel, const glm::ivec2& pos, u_int rotation, bool first = false) noexcept
   {
-    // Panel端をここで調べる
-    const auto p = panels_[panel];
-    auto edge = p.getRotatedEdgeValue(rotation);
-    field.addPanel(panel, pos, rotation, edge);
-    //置ける場所を探す
-    blank_ = field.searchBlank();
-
-    {
-      Arguments args{
-        { "panel",        panel },
-        { "field_pos",    pos },
-        { "rotation",     rotation },
-        { "total_panels", total_panels },
-        { "first",        first },
-        { "remain_panel", u_int(waiting_panels.size()) },
-      };
-      event_.signal("Game:PutPanel", args);
-    }
+    Arguments args{
+      { "panel",        panel },
+      { "field_pos",    pos },
+      { "rotation",     rotation },
+      { "total_panels", sim_.total_panels },
+      { "first",        first },
+      { "remain_panel", u_int(sim_.waiting_panels.size()) },
+    };
+    event_.signal("Game:PutPanel", args);
   }
 
 
@@ -985,7 +1020,15 @@ private:
   Event<Arguments>& event_;
   const std::vector<Panel>& panels_;
 
-  std::mt19937 engine_;
+  // 乱数の種(ゲーム中の乱数は全てここから)
+  uint32_t seed_;
+
+  // ゲームのルール部分
+  Simulator sim_;
+  // パネルを置いた記録
+  MoveLog move_log_;
+  // 戻した手(置いた場所と回転)
+  std::vector<std::pair<glm::ivec2, u_int>> redo_moves_;
 
   CountExec count_exec_;
 
@@ -994,51 +1037,27 @@ private:
 
   double initial_play_time_;
   double play_time_;
+  // 開始してからの経過時間
+  double elapsed_time_ = 0.0;
+
+  // ヒント
+  bool hint_enabled_;
+  u_int hint_depth_;
+  HintEngine hint_;
   // 制限時間の有無
   bool time_limited_ = true;
 #if defined (DEBUG)
   bool time_count = true;
 #endif
 
-  bool is_tutorial_ = false;
-
-  // 配置するパネル
-  std::vector<int> waiting_panels;
-  // 最初に中央に配置するパネル
-  int start_panel_;
-  // 手持ちのパネル
-  int hand_panel;
-  u_int hand_rotation;
-
-  Field field;
-  
-  // 列挙した置ける箇所
-  std::vector<glm::ivec2> blank_;
-
-  // 完成した森
-  std::vector<std::vector<glm::ivec2>> completed_forests;
-  // 深い森
-  std::vector<u_int> deep_forest;
-  // 完成した道
-  std::vector<std::vector<glm::ivec2>> completed_path;
-  // 完成した教会
-  std::vector<glm::ivec2> completed_church;
-
   // パネルを回した回数
   u_int panel_turned_times_ = 0;
   // パネルを移動した回数
   u_int panel_moved_times_ = 0;
 
   // スコア
-  std::vector<u_int> scores_;
   u_int total_score   = 0;
   u_int total_ranking = 0;
-  u_int total_panels  = 0;
-
-  // 最長道
-  u_int max_path_ = 0;
-  // 最大森
-  u_int max_forest_ = 0;
 
 #if defined (DEBUG)
 public:
@@ -229,6 +229,25 @@ public:
                                updateScoreWidget(3, panels);
                              });
 
+    // 一手戻した
+    holder_ += event.connect("Game:Undo",
+                             [this](const Connection&, const Arguments& args)
+                             {
+                               // 森、道、教会の数
+                               // FIXME Magic Number
+                               const auto& scores = boost::any_cast<const std::vector<u_int>&>(args.at("scores"));
+                               scores_[0] = scores[2];
+                               scores_[1] = scores[0];
+                               scores_[2] = scores[6];
+                               for (int i = 0; i < 3; ++i)
+                               {
+                                 updateScoreWidget(i, scores_[i]);
+                               }
+
+                               auto panels = getValue<u_int>(args, "remain_panel");
+                               updateScoreWidget(3, panels);
+                             });
+
     // Like演出
     holder_ += event.connect("Game:convertPos",
                              [this](const Connection&, const Arguments& args)
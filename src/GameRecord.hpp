@@ -0,0 +1,322 @@
+﻿#pragma once
+
+//
+// ゲームの記録(保存用のバイナリ書式)
+//   JSONで保存していた時より一桁小さく、読み込みも解析無しで済む
+//
+// 書式(特に断りが無ければ可変長整数)
+//   "PMGR" version(1byte) flags(1byte)
+//   total_score total_ranking
+//   play_time(8byte double little endian)
+//   panel_turned_times panel_moved_times
+//   hand_panel(zigzag) hand_rotation
+//   パネルの数 以降、置いた順に
+//     number * 4 + rotation
+//     前のパネルからの位置の差分x, y(zigzag)
+//   待ちパネルの数 パネル番号...
+//   完成した森の数 以降、森ごとに
+//     深い森の数 パネルの数 前のパネルからの置いた順番の差分(zigzag)...
+//   完成した道の数 以降、道ごとに
+//     パネルの数 前のパネルからの置いた順番の差分(zigzag)...
+//   完成した教会の数 前のパネルからの置いた順番の差分(zigzag)...
+//   MoveLogの長さ MoveLog
+//
+// NOTICE 辺の情報はパネル番号と向きから求まるので保存しない
+//
+
+#include <vector>
+#include <string>
+#include <map>
+#include <set>
+#include <algorithm>
+#include <cstring>
+#include <glm/glm.hpp>
+#include "Misc.hpp"
+#include "Varint.hpp"
+
+
+namespace ngs {
+
+struct GameRecord
+{
+  enum {
+    VERSION = 1,
+    // "PMGR" version flags
+    HEADER_SIZE = 6,
+  };
+
+  enum Flag {
+    TUTORIAL = 1 << 0,
+    ENDLESS  = 1 << 1,
+    // 得点が記録されている
+    SCORED   = 1 << 2,
+  };
+
+  // 置いたパネル
+  struct Placed
+  {
+    int number;
+    glm::ivec2 position;
+    u_int rotation;
+  };
+
+
+  u_int flags = 0;
+
+  u_int total_score   = 0;
+  u_int total_ranking = 0;
+
+  double play_time = 0.0;
+  u_int panel_turned_times = 0;
+  u_int panel_moved_times  = 0;
+
+  int hand_panel      = -1;
+  u_int hand_rotation = 0;
+
+  // 置いた順
+  std::vector<Placed> panels;
+  std::vector<int> waiting_panels;
+
+  std::vector<std::vector<glm::ivec2>> completed_forests;
+  std::vector<u_int> deep_forest;
+  std::vector<std::vector<glm::ivec2>> completed_path;
+  std::vector<glm::ivec2> completed_church;
+
+  // MoveLog::serializeの結果
+  std::string move_log;
+
+
+  // バイナリの記録か
+  static bool isRecord(const char* data, size_t size) noexcept
+  {
+    return size >= HEADER_SIZE && std::memcmp(data, "PMGR", 4) == 0;
+  }
+
+
+  // バイナリに変換
+  // 完成したパネルが置いたパネルに無ければfalse
+  bool serialize(std::string& data) const noexcept
+  {
+    if (deep_forest.size() != completed_forests.size()) return false;
+
+    // 位置→置いた順番
+    std::map<glm::ivec2, u_int, LessVec<glm::ivec2>> indices;
+    for (u_int i = 0; i < panels.size(); ++i)
+    {
+      indices.emplace(panels[i].position, i);
+    }
+
+    data.assign("PMGR");
+    data.push_back(char(VERSION));
+    data.push_back(char(flags));
+
+    Varint::write(data, total_score);
+    Varint::write(data, total_ranking);
+
+    uint64_t bits;
+    std::memcpy(&bits, &play_time, sizeof(bits));
+    for (int i = 0; i < 8; ++i)
+    {
+      data.push_back(char((bits >> (i * 8)) & 0xff));
+    }
+
+    Varint::write(data, panel_turned_times);
+    Varint::write(data, panel_moved_times);
+    Varint::write(data, Varint::zigzag(hand_panel));
+    Varint::write(data, hand_rotation);
+
+    Varint::write(data, u_int(panels.size()));
+    glm::ivec2 position(0, 0);
+    for (const auto& p : panels)
+    {
+      Varint::write(data, p.number * 4 + p.rotation);
+      Varint::write(data, Varint::zigzag(p.position.x - position.x));
+      Varint::write(data, Varint::zigzag(p.position.y - position.y));
+      position = p.position;
+    }
+
+    Varint::write(data, u_int(waiting_panels.size()));
+    for (auto number : waiting_panels)
+    {
+      Varint::write(data, number);
+    }
+
+    Varint::write(data, u_int(completed_forests.size()));
+    for (size_t i = 0; i < completed_forests.size(); ++i)
+    {
+      Varint::write(data, deep_forest[i]);
+      if (!writeGroup(data, completed_forests[i], indices)) return false;
+    }
+
+    Varint::write(data, u_int(completed_path.size()));
+    for (const auto& group : completed_path)
+    {
+      if (!writeGroup(data, group, indices)) return false;
+    }
+
+    if (!writeGroup(data, completed_church, indices)) return false;
+
+    Varint::write(data, u_int(move_log.size()));
+    data.append(move_log);
+
+    return true;
+  }
+
+  // バイナリから復元
+  // 壊れていたらfalse(panel_num: パネルの総数)
+  // NOTICE 読み込み元は複製せずにそのまま読む
+  bool deserialize(const char* data, size_t size, size_t panel_num) noexcept
+  {
+    if (!isRecord(data, size)) return false;
+    if (u_char(data[4]) != VERSION) return false;
+
+    flags = u_char(data[5]);
+    size_t ofs = HEADER_SIZE;
+
+    if (!read(data, size, ofs, total_score)) return false;
+    if (!read(data, size, ofs, total_ranking)) return false;
+
+    if (size - ofs < 8) return false;
+    uint64_t bits = 0;
+    for (int i = 0; i < 8; ++i)
+    {
+      bits |= uint64_t(u_char(data[ofs++])) << (i * 8);
+    }
+    std::memcpy(&play_time, &bits, sizeof(bits));
+
+    uint32_t value;
+    if (!read(data, size, ofs, panel_turned_times)) return false;
+    if (!read(data, size, ofs, panel_moved_times)) return false;
+    if (!Varint::read(data, size, ofs, value)) return false;
+    hand_panel = Varint::unzigzag(value);
+    if (!read(data, size, ofs, hand_rotation)) return false;
+
+    uint32_t num;
+    if (!readCount(data, size, ofs, num)) return false;
+    panels.clear();
+    panels.reserve(num);
+    glm::ivec2 position(0, 0);
+    for (uint32_t i = 0; i < num; ++i)
+    {
+      uint32_t v[3];
+      for (auto& x : v)
+      {
+        if (!Varint::read(data, size, ofs, x)) return false;
+      }
+
+      position += glm::ivec2(Varint::unzigzag(v[1]), Varint::unzigzag(v[2]));
+      panels.push_back({ int(v[0] / 4), position, v[0] % 4 });
+    }
+
+    if (!readCount(data, size, ofs, num)) return false;
+    waiting_panels.resize(num);
+    for (auto& number : waiting_panels)
+    {
+      if (!Varint::read(data, size, ofs, value)) return false;
+      number = int(value);
+    }
+
+    if (!readCount(data, size, ofs, num)) return false;
+    completed_forests.resize(num);
+    deep_forest.resize(num);
+    for (uint32_t i = 0; i < num; ++i)
+    {
+      if (!read(data, size, ofs, deep_forest[i])) return false;
+      if (!readGroup(data, size, ofs, completed_forests[i])) return false;
+    }
+
+    if (!readCount(data, size, ofs, num)) return false;
+    completed_path.resize(num);
+    for (auto& group : completed_path)
+    {
+      if (!readGroup(data, size, ofs, group)) return false;
+    }
+
+    if (!readGroup(data, size, ofs, completed_church)) return false;
+
+    if (!readCount(data, size, ofs, num)) return false;
+    move_log.assign(data + ofs, num);
+    ofs += num;
+
+    return (ofs == size) && validate(panel_num);
+  }
+
+  // パネル番号と置いた場所を確かめる
+  // NOTICE 同じ場所に２枚置くとFieldが壊れるので、重なっていたら壊れている
+  bool validate(size_t panel_num) const noexcept
+  {
+    auto valid = [panel_num](int number)
+                 {
+                   return number >= 0 && number < int(panel_num);
+                 };
+
+    // 手持ちは無くても良い
+    if (hand_panel != -1 && !valid(hand_panel)) return false;
+    if (hand_rotation > 3) return false;
+    if (!std::all_of(std::begin(waiting_panels), std::end(waiting_panels), valid)) return false;
+
+    std::set<glm::ivec2, LessVec<glm::ivec2>> positions;
+    for (const auto& p : panels)
+    {
+      if (!valid(p.number) || p.rotation > 3) return false;
+      if (!positions.insert(p.position).second) return false;
+    }
+    return true;
+  }
+
+
+private:
+  // 完成したパネル群を置いた順番の差分で書き出す
+  static bool writeGroup(std::string& data, const std::vector<glm::ivec2>& group,
+                         const std::map<glm::ivec2, u_int, LessVec<glm::ivec2>>& indices) noexcept
+  {
+    Varint::write(data, u_int(group.size()));
+    int prev = 0;
+    for (const auto& pos : group)
+    {
+      auto it = indices.find(pos);
+      if (it == std::end(indices)) return false;
+
+      int index = int(it->second);
+      Varint::write(data, Varint::zigzag(index - prev));
+      prev = index;
+    }
+    return true;
+  }
+
+  bool readGroup(const char* data, size_t size, size_t& ofs, std::vector<glm::ivec2>& group) const noexcept
+  {
+    uint32_t num;
+    if (!readCount(data, size, ofs, num)) return false;
+
+    group.resize(num);
+    int index = 0;
+    for (auto& pos : group)
+    {
+      uint32_t value;
+      if (!Varint::read(data, size, ofs, value)) return false;
+
+      index += Varint::unzigzag(value);
+      if (index < 0 || index >= int(panels.size())) return false;
+      pos = panels[index].position;
+    }
+    return true;
+  }
+
+  static bool read(const char* data, size_t size, size_t& ofs, u_int& v) noexcept
+  {
+    uint32_t value;
+    if (!Varint::read(data, size, ofs, value)) return false;
+    v = value;
+    return true;
+  }
+
+  // 要素の数
+  // TIPS 残りのバイト数より多ければ壊れている(巨大な確保を防ぐ)
+  static bool readCount(const char* data, size_t size, size_t& ofs, uint32_t& num) noexcept
+  {
+    return Varint::read(data, size, ofs, num) && num <= size - ofs;
+  }
+};
+
+}
@@ -0,0 +1,191 @@
+﻿#pragma once
+
+//
+// 一番良い置き場所を探す(ヒント)
+//   別スレッドで探索して、結果はメインスレッドが取りに来る
+//   盤面は依頼した時点の複製を使うので、メインスレッドと共有しない
+//   先読みは複製を１つだけ作り、置いては取り消して調べる
+//
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <memory>
+#include <boost/noncopyable.hpp>
+#include "Simulator.hpp"
+
+
+namespace ngs {
+
+class HintEngine
+  : private boost::noncopyable
+{
+public:
+  struct Hint
+  {
+    glm::ivec2 position;
+    u_int rotation;
+    // 置いた後の最終スコア(先読み込み)
+    u_int score;
+  };
+
+
+  HintEngine() = default;
+
+  ~HintEngine()
+  {
+    if (!worker_.joinable()) return;
+
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      quit_ = true;
+      generation_ += 1;
+    }
+    cond_.notify_one();
+    worker_.join();
+  }
+
+
+  // 探索を依頼(実行中の探索は中止)
+  // depth: 後に配られるパネルを何枚先読みするか
+  void request(std::shared_ptr<const Simulator> snapshot, u_int depth) noexcept
+  {
+    if (!worker_.joinable())
+    {
+      worker_ = std::thread([this]() { run(); });
+    }
+
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      snapshot_           = std::move(snapshot);
+      depth_              = depth;
+      request_generation_ = ++generation_;
+    }
+    cond_.notify_one();
+  }
+
+  // 探索を中止
+  void cancel() noexcept
+  {
+    generation_ += 1;
+  }
+
+  // 結果が出ていれば取り出す
+  // NOTICE 依頼と同じスレッドから呼ぶ
+  bool poll(Hint& hint) noexcept
+  {
+    auto generation = generation_.load();
+    if (finished_.load(std::memory_order_acquire) != generation) return false;
+
+    hint = hint_;
+    // 一度だけ取り出す
+    finished_.store(0, std::memory_order_relaxed);
+    return true;
+  }
+
+
+private:
+  void run() noexcept
+  {
+    while (true)
+    {
+      std::shared_ptr<const Simulator> snapshot;
+      u_int depth;
+      uint32_t generation;
+      {
+        std::unique_lock<std::mutex> lock(mutex_);
+        cond_.wait(lock, [this]() { return quit_ || snapshot_; });
+        if (quit_) return;
+
+        snapshot   = std::move(snapshot_);
+        depth      = depth_;
+        generation = request_generation_;
+      }
+
+      Hint hint;
+      if (search(*snapshot, depth, generation, hint))
+      {
+        hint_ = hint;
+        // NOTICE 世代が変わっていたらpollで無視される
+        finished_.store(generation, std::memory_order_release);
+      }
+    }
+  }
+
+  bool canceled(uint32_t generation) const noexcept
+  {
+    return generation_.load(std::memory_order_relaxed) != generation;
+  }
+
+  // 手持ちパネルの置き場所を全て試す
+  bool search(const Simulator& sim, u_int depth, uint32_t generation, Hint& hint) const noexcept
+  {
+    auto places = sim.searchHandPanelPlaces();
+    if (places.empty()) return false;
+
+    Simulator s = sim;
+    s.setUndoEnabled(true);
+
+    bool found = false;
+    for (const auto& place : places)
+    {
+      if (canceled(generation)) return false;
+
+      s.hand_rotation = place.second;
+      s.putHandPanel(place.first);
+      s.checkCompleted(place.first);
+
+      auto score = evaluate(s, depth, generation);
+      s.undo();
+      if (!found || score > hint.score)
+      {
+        hint  = { place.first, place.second, score };
+        found = true;
+      }
+    }
+
+    return found && !canceled(generation);
+  }
+
+  // 次に配られるパネルを最善の場所に置いた時のスコア
+  // NOTICE 配ったパネルは呼び出し側のundoで戻る
+  u_int evaluate(Simulator& sim, u_int depth, uint32_t generation) const noexcept
+  {
+    if (depth == 0 || !sim.getNextPanel()) return sim.calcTotalScore();
+
+    u_int best = 0;
+    for (const auto& place : sim.searchHandPanelPlaces())
+    {
+      if (canceled(generation)) break;
+
+      sim.hand_rotation = place.second;
+      sim.putHandPanel(place.first);
+      sim.checkCompleted(place.first);
+
+      best = std::max(best, evaluate(sim, depth - 1, generation));
+      sim.undo();
+    }
+
+    return best;
+  }
+
+
+  std::thread worker_;
+
+  std::mutex mutex_;
+  std::condition_variable cond_;
+  bool quit_ = false;
+
+  // 依頼や中止ごとに増える(0は結果無しに使う)
+  std::atomic<uint32_t> generation_ { 1 };
+  std::shared_ptr<const Simulator> snapshot_;
+  u_int depth_ = 0;
+  uint32_t request_generation_ = 0;
+
+  // 探索が終わった世代と結果
+  std::atomic<uint32_t> finished_ { 0 };
+  Hint hint_;
+};
+
+}
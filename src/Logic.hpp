@@ -6,11 +6,25 @@
 
 #include "Panel.hpp"
 #include "Field.hpp"
+#include "PanelType.hpp"
 #include <set>
 
 
 namespace ngs {
 
+// ４方向の回転それぞれで置けるか判定
+// 置ける回転のビットが立った値(0~15)を返す
+// TIPS 回転済みの端情報は表引きなので、分岐無しの比較４回で済む
+u_int getPutableRotation(const Panel& panel, const BlankEdge& blank) noexcept
+{
+  u_int rotation = 0;
+  for (u_int i = 0; i < 4; ++i)
+  {
+    rotation |= u_int(blank.match(panel.getRotatedEdgeValue(i))) << i;
+  }
+  return rotation;
+}
+
 // Fieldにパネルが置けるか判定
 bool canPutPanel(const Panel& panel, const glm::ivec2& pos, u_int rotation, const Field& field) noexcept
 {
@@ -24,6 +38,10 @@ bool canPutPanel(const Panel& panel, const glm::ivec2& pos, u_int rotation, cons
 
   // ４隅の情報
   auto edge = panel.getRotatedEdgeValue(rotation);
+
+  // TIPS 置ける場所は周囲の端情報を保持している
+  if (field.isBlank(pos)) return field.getBlankEdge(pos).match(edge);
+
   auto field_edge = edge;
 
   for (u_int i = 0; i < 4; ++i)
@@ -73,7 +91,7 @@ bool checkAttributeEdge(const glm::ivec2& pos, u_int direction,
   // パネル情報
   const auto& status = field.getPanelStatus(pos);
   const auto& panel  = panels[status.number];
-  const auto edge    = panel.getRotatedEdge(status.rotation);
+  const auto& edge   = panel.getRotatedEdge(status.rotation);
 
   u_int dir = (direction + 2) % 4;
 
@@ -139,7 +157,7 @@ std::vector<std::vector<glm::ivec2>> isCompleteAttribute(u_int attribute,
   // パネル情報
   const auto& status = field.getPanelStatus(pos);
   const auto& panel  = panels[status.number];
-  const auto edge    = panel.getRotatedEdge(status.rotation);
+  const auto& edge   = panel.getRotatedEdge(status.rotation);
 
   // パネルは端か途中かの２択(両方含んだ道は無い)
   bool has_attr = false;
@@ -351,20 +369,54 @@ int countTown(const std::vector<std::vector<glm::ivec2>>& completed,
 
 
 // 手持ちのパネルがフィールドにおけるか調べる
-bool canPanelPutField(const Panel& panel, const std::vector<glm::ivec2>& blank, const Field& field) noexcept
+bool canPanelPutField(const Panel& panel, const Field& field) noexcept
+{
+  // TIPS 端情報が同じ場所はまとめて調べる
+  const auto& patterns = field.getBlankPatterns();
+  return std::any_of(std::begin(patterns), std::end(patterns),
+                     [&panel](const BlankPattern& pattern)
+                     {
+                       return getPutableRotation(panel, pattern.blank) != 0;
+                     });
+}
+
+// 複数のパネルについて置ける場所と回転を調べる
+// 結果はパネルごとに、置ける場所ごとの置ける回転(getPutableRotationの値)
+// NOTICE 置ける場所の並びはField::getBlankPositionsと同じ
+std::vector<std::vector<u_char>> searchPutablePlaces(const std::vector<int>& numbers,
+                                                     const std::vector<Panel>& panels, const Field& field) noexcept
 {
-  // 総当たりで調査
-  for (const auto& pos : blank)
+  const auto& blank_edges = field.getBlankEdges();
+
+  std::vector<std::vector<u_char>> putable(numbers.size(), std::vector<u_char>(blank_edges.size()));
+  for (size_t k = 0; k < numbers.size(); ++k)
   {
-    for (u_int i = 0; i < 4; ++i)
+    const auto& panel = panels[numbers[k]];
+    auto& rotations   = putable[k];
+    for (size_t i = 0; i < blank_edges.size(); ++i)
     {
-      if (canPutPanel(panel, pos, i, field))
-      {
-        return true;
-      }
+      rotations[i] = u_char(getPutableRotation(panel, blank_edges[i]));
     }
   }
-  return false;
+
+  return putable;
+}
+
+// 待ちパネルを先頭から調べて、最初に置けるパネルの位置を返す(無ければ-1)
+// TIPS 置けるかどうかは形だけで決まるので、同じ形のパネルは調べ直さない
+int findNextPanel(const std::vector<int>& waiting, const std::vector<Panel>& panels,
+                  const PanelTypes& types, const Field& field) noexcept
+{
+  std::vector<char> checked(types.shapeSize(), 0);
+  for (size_t i = 0; i < waiting.size(); ++i)
+  {
+    auto& c = checked[types.getShape(waiting[i])];
+    if (c) continue;
+
+    if (canPanelPutField(panels[waiting[i]], field)) return int(i);
+    c = 1;
+  }
+  return -1;
 }
 
 }
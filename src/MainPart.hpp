@@ -37,10 +37,11 @@ class MainPart
 {
 
 public:
-  MainPart(const ci::JsonTree& params, Event<Arguments>& event, Archive& archive) noexcept
+  MainPart(const ci::JsonTree& params, Event<Arguments>& event, Archive& archive, Persistence& persistence) noexcept
     : params_(params),
       event_(event),
       archive_(archive),
+      persistence_(persistence),
       panels_(createPanels()),
       game_(std::make_unique<Game>(params["game"], event, Archive::isPurchased(archive), panels_)),
       draged_max_length_(params.getValueForKey<float>("field.draged_max_length")),
@@ -462,6 +463,44 @@ public:
                                 }
                               });
 
+    // 一手戻した
+    holder_ += event_.connect("Game:Undo",
+                              [this](const Connection&, const Arguments& args) noexcept
+                              {
+                                const auto& pos = getValue<glm::ivec2>(args, "field_pos");
+                                view_.removeLastPanel(pos);
+                                view_.updateBlank(game_->getBlankPositions());
+
+                                // 取り除いた場所に手持ちパネルを戻す
+                                setHandPanelPosition(pos);
+                                calcViewRange(true);
+                              });
+
+    holder_ += event_.connect("undo:touch_ended",
+                              [this](const Connection&, const Arguments&) noexcept
+                              {
+                                if (paused_ || prohibited_ || !game_->canUndo()) return;
+                                game_->undo();
+                              });
+
+    holder_ += event_.connect("redo:touch_ended",
+                              [this](const Connection&, const Arguments&) noexcept
+                              {
+                                if (paused_ || prohibited_ || disable_panel_put_ || !game_->canRedo()) return;
+                                game_->redo();
+                                game_event_.insert("Panel:put"s);
+
+                                if (game_->isPlaying())
+                                {
+                                  calcNextPanelPosition();
+                                  calcViewRange(true);
+                                }
+                                else
+                                {
+                                  view_.noNextPanel();
+                                }
+                              });
+
     holder_ += event_.connect("Game:Finish",
                               [this](const Connection&, const Arguments& args) noexcept
                               {
@@ -913,6 +952,7 @@ public:
                                 game_ = std::make_unique<Game>(params_["game"], event_,
                                                                Archive::isPurchased(archive_), panels_);
 
+                                persistence_.flush(path);
                                 ScoreTest test(event_, path);
                                 game_->testCalcResults(); 
                               });
@@ -1223,7 +1263,13 @@ private:
   // 次のパネルの出現位置を決める
   void calcNextPanelPosition() noexcept
   {
-    field_pos_ = game_->getNextPanelPosition(field_pos_);
+    setHandPanelPosition(game_->getNextPanelPosition(field_pos_));
+  }
+
+  // 手持ちパネルを指定位置へ
+  void setHandPanelPosition(const glm::ivec2& pos) noexcept
+  {
+    field_pos_ = pos;
 
     cursor_pos_ = glm::vec3(field_pos_.x * PANEL_SIZE, panel_height_, field_pos_.y * PANEL_SIZE);
     view_.setPanelPosition(cursor_pos_);
@@ -1355,8 +1401,8 @@ private:
   {
     archive_.setRecord("saved", true); 
     
-    auto path = std::string("game-") + getFormattedDate() + ".json";
-    game_->save(path);
+    auto path = std::string("game-") + getFormattedDate() + ".data";
+    game_->save(path, persistence_);
     // pathを記録
     auto game_json = ci::JsonTree::makeObject();
     game_json.addChild(ci::JsonTree("path",  path))
@@ -1391,17 +1437,8 @@ private:
         if (json[ranking_records_].hasChild("path"))
         {
           auto p = json[ranking_records_].getValueForKey<std::string>("path");
-          auto full_path = getDocumentPath() / p;
           // ファイルを削除
-          try
-          {
-            DOUT << "remove: " << full_path << std::endl;
-            ci::fs::remove(full_path);
-          }
-          catch (ci::fs::filesystem_error& ex)
-          {
-            DOUT << ex.what() << std::endl;
-          }
+          persistence_.remove(getDocumentPath() / p);
         }
 #endif
 
@@ -1444,17 +1481,8 @@ private:
       if (game.hasChild("path"))
       {
         auto p = game.getValueForKey<std::string>("path");
-        auto full_path = getDocumentPath() / p;
         // ファイルを削除
-        try
-        {
-          DOUT << "remove: " << full_path << std::endl;
-          ci::fs::remove(full_path);
-        }
-        catch (ci::fs::filesystem_error& ex)
-        {
-          DOUT << ex.what() << std::endl;
-        }
+        persistence_.remove(getDocumentPath() / p);
       }
     }
 
@@ -1481,6 +1509,8 @@ private:
       // view_.clearAll();
       auto delay = view_.removeFieldPanels();
       auto full_path = getDocumentPath() / json[rank].getValueForKey<std::string>("path");
+      // NOTICE 書き出し中の記録は、書き出しが終わってから読む
+      persistence_.flush(full_path);
       game_->load(full_path, delay);
       calcViewRange(false);
       game_event_.insert("Panel:clear"s);
@@ -1564,7 +1594,7 @@ private:
         { -1,  0 },
       };
       
-      auto panels = game_->searchPanelsAtEdge(Panel::FOREST);
+      auto panels = game_->searchPanelsAtOpenEdge(Panel::FOREST);
       for (const auto& p : panels)
       {
         auto pos = vec2ToVec3(p * int(PANEL_SIZE));
@@ -1660,12 +1690,13 @@ private:
 
   // プレイ記録 
   Archive& archive_;
+  Persistence& persistence_;
 
   bool paused_ = false;
   // true: カメラ操作不可
   bool prohibited_ = false;
 
-  std::vector<Panel> panels_;
+  const std::vector<Panel>& panels_;
   std::unique_ptr<Game> game_;
 
   // パネル操作
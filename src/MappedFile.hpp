@@ -0,0 +1,111 @@
+﻿#pragma once
+
+//
+// 読み込み専用でファイルの内容を参照する
+//   大きいファイルはメモリにマップして、ヒープへコピーせずに参照する
+//   小さいファイルはマップせず、ちょうどの大きさの領域へ１回で読み込む
+//
+// NOTICE 小さいファイルをマップすると、読み込むよりも遅い
+//        (マップと解放、ページフォルトの分)
+//        開けなかった時はisValid()がfalse
+//
+
+#include <string>
+#include <fstream>
+#include <boost/noncopyable.hpp>
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+
+
+namespace ngs {
+
+class MappedFile
+  : private boost::noncopyable
+{
+  enum {
+    // これ以上の大きさならマップする
+    MAP_MIN_SIZE = 1024 * 128,
+  };
+
+
+public:
+  MappedFile(const std::string& path) noexcept
+  {
+    // TIPS １回で読むので、ストリームのバッファは使わない
+    std::ifstream fstr;
+    fstr.rdbuf()->pubsetbuf(nullptr, 0);
+    fstr.open(path, std::ios::binary | std::ios::ate);
+    if (!fstr) return;
+
+    auto size = size_t(fstr.tellg());
+    if (size < MAP_MIN_SIZE)
+    {
+      buffer_.resize(size);
+      fstr.seekg(0, std::ios::beg);
+      fstr.read(&buffer_[0], size);
+
+      data_  = buffer_.data();
+      size_  = size;
+      valid_ = bool(fstr);
+      return;
+    }
+    fstr.close();
+
+    try
+    {
+      boost::interprocess::file_mapping file(path.c_str(), boost::interprocess::read_only);
+      // TIPS マップした領域はfileを閉じても残る
+      region_ = boost::interprocess::mapped_region(file, boost::interprocess::read_only);
+
+      data_  = static_cast<const char*>(region_.get_address());
+      size_  = region_.get_size();
+      valid_ = true;
+    }
+    catch (boost::interprocess::interprocess_exception&)
+    {
+    }
+  }
+
+
+  bool isValid() const noexcept
+  {
+    return valid_;
+  }
+
+  const char* data() const noexcept
+  {
+    return data_;
+  }
+
+  size_t size() const noexcept
+  {
+    return size_;
+  }
+
+  // 内容をstd::stringで受け取る
+  // TIPS マップしていなければ、読み込んだ領域をそのまま渡す(コピーしない)
+  // NOTICE 受け取った後は空になる
+  std::string release() noexcept
+  {
+    std::string text = (data_ == buffer_.data()) ? std::move(buffer_)
+                                                 : std::string(data_, size_);
+
+    region_ = boost::interprocess::mapped_region();
+    buffer_.clear();
+    data_ = buffer_.data();
+    size_ = 0;
+
+    return text;
+  }
+
+
+private:
+  boost::interprocess::mapped_region region_;
+  std::string buffer_;
+
+  const char* data_ = nullptr;
+  size_t size_ = 0;
+  bool valid_  = false;
+};
+
+}
@@ -0,0 +1,90 @@
+﻿#pragma once
+
+//
+// 雑多な処理
+//   Cinderに依存しないもの
+//
+
+#include <cstdint>
+#include <iterator>
+#include <algorithm>
+#include "Defines.hpp"
+
+
+namespace ngs {
+
+// 比較関数(a < b を計算する)
+// SOURCE:http://tankuma.exblog.jp/11670448/
+template <typename T>
+struct LessVec
+{
+  bool operator()(const T& lhs, const T& rhs) const noexcept
+  {
+    for (int i = 0; i < lhs.length(); ++i)
+    {
+      if (lhs[i] < rhs[i]) return true;
+      if (lhs[i] > rhs[i]) return false;
+    }
+
+    return false;
+  }
+};
+
+// 配列の要素数を取得
+template <typename T>
+constexpr std::size_t elemsof(const T& value) noexcept
+{
+  return std::end(value) - std::begin(value);
+}
+
+// ビットローテート
+// SOURCE http://qune.jp/archive/001213/index.html
+template<typename T>
+T rotateRight(T x, unsigned int n) noexcept
+{
+  // s = n % (sizeof(T) * 8)
+  unsigned int s = (n & ((sizeof(T) << 3) - 1));
+  return (x >> n) | (x << ((sizeof(T) << 3) - s));
+}
+
+// 左シフト
+template<typename T>
+T rotateLeft(T x, unsigned int n) noexcept
+{
+  // s = n % (sizeof(T) * 8)
+  unsigned int s = (n & ((sizeof(T) << 3) - 1));
+  return (x << s) | (x >> ((sizeof(T) << 3) - s));
+}
+
+
+// 複製しても引き継がない値
+// TIPS 取り消し用の記録など、複製先で共有したくないものに使う
+//      複製先は初期値から始まる
+template <typename T>
+struct NotCopied
+{
+  T value;
+
+  NotCopied() = default;
+
+  NotCopied(const NotCopied&) noexcept
+    : value()
+  {
+  }
+
+  NotCopied& operator=(const NotCopied&) noexcept
+  {
+    value = T();
+    return *this;
+  }
+};
+
+
+// コンテナへ追記
+template<typename T1, typename T2>
+void appendContainer(const T1& src, T2& dst) noexcept
+{
+  std::copy(std::begin(src), std::end(src), std::back_inserter(dst));
+}
+
+}
@@ -0,0 +1,186 @@
+﻿#pragma once
+
+//
+// パネルを置いた記録
+//   乱数の種と置いた順番があれば、ゲームを完全に再現できる
+//
+// 書式
+//   "PMLG" version(1byte) flags(1byte) seed(4byte little endian)
+//   以降、１手ごとに可変長整数で
+//     panel * 4 + rotation
+//     前の手からの位置の差分x, y(zigzag)
+//     前の手からの経過時間[ms]
+//
+
+#include <vector>
+#include <string>
+#include "Simulator.hpp"
+#include "Varint.hpp"
+
+
+namespace ngs {
+
+struct MoveLog
+{
+  enum {
+    VERSION = 1,
+  };
+
+  enum Flag {
+    TUTORIAL = 1 << 0,
+    ENDLESS  = 1 << 1,
+  };
+
+  struct Move
+  {
+    int panel;
+    u_int rotation;
+    glm::ivec2 position;
+    // ゲーム開始からの時間[ms]
+    u_int time;
+  };
+
+
+  MoveLog() = default;
+
+  MoveLog(uint32_t seed, u_int flags = 0) noexcept
+    : seed_(seed),
+      flags_(flags)
+  {
+  }
+
+
+  void record(int panel, u_int rotation, const glm::ivec2& position, u_int time) noexcept
+  {
+    moves_.push_back({ panel, rotation, position, time });
+  }
+
+  // 最後の手を取り消す
+  void cancel() noexcept
+  {
+    if (!moves_.empty()) moves_.pop_back();
+  }
+
+  uint32_t getSeed() const noexcept
+  {
+    return seed_;
+  }
+
+  u_int getFlags() const noexcept
+  {
+    return flags_;
+  }
+
+  const std::vector<Move>& getMoves() const noexcept
+  {
+    return moves_;
+  }
+
+
+  // バイナリに変換
+  std::string serialize() const noexcept
+  {
+    std::string data("PMLG");
+    data.push_back(char(VERSION));
+    data.push_back(char(flags_));
+    for (int i = 0; i < 4; ++i)
+    {
+      data.push_back(char((seed_ >> (i * 8)) & 0xff));
+    }
+
+    glm::ivec2 position(0, 0);
+    u_int time = 0;
+    for (const auto& move : moves_)
+    {
+      Varint::write(data, move.panel * 4 + move.rotation);
+      Varint::write(data, Varint::zigzag(move.position.x - position.x));
+      Varint::write(data, Varint::zigzag(move.position.y - position.y));
+      Varint::write(data, move.time - time);
+
+      position = move.position;
+      time     = move.time;
+    }
+
+    return data;
+  }
+
+  // バイナリから復元
+  // 壊れていたらfalse
+  bool deserialize(const std::string& data) noexcept
+  {
+    if (data.size() < 10 || data.compare(0, 4, "PMLG") != 0) return false;
+    if (u_char(data[4]) != VERSION) return false;
+
+    flags_ = u_char(data[5]);
+    seed_  = 0;
+    for (int i = 0; i < 4; ++i)
+    {
+      seed_ |= uint32_t(u_char(data[6 + i])) << (i * 8);
+    }
+
+    moves_.clear();
+    size_t ofs = 10;
+    glm::ivec2 position(0, 0);
+    u_int time = 0;
+    while (ofs < data.size())
+    {
+      uint32_t value[4];
+      for (auto& v : value)
+      {
+        if (!Varint::read(data.data(), data.size(), ofs, v)) return false;
+      }
+
+      position += glm::ivec2(Varint::unzigzag(value[1]), Varint::unzigzag(value[2]));
+      time     += value[3];
+      moves_.push_back({ int(value[0] / 4), value[0] % 4, position, time });
+    }
+
+    return true;
+  }
+
+
+  // 記録通りにゲームを再現する
+  // 手持ちのパネルや置く場所が記録と食い違ったらfalse
+  // NOTICE チュートリアルは配るパネルを別途渡す
+  bool replay(Simulator& sim, const std::vector<int>& tutorial_panels = {}) const noexcept
+  {
+    if (moves_.empty()) return false;
+
+    if (flags_ & TUTORIAL)
+    {
+      sim.preparationPanel(tutorial_panels);
+    }
+    else
+    {
+      sim.preparationPanel();
+    }
+    sim.setEndless(flags_ & ENDLESS);
+
+    // 最初のパネル
+    auto rotation = sim.putFirstPanel();
+    const auto& first = moves_[0];
+    if (first.panel != sim.getStartPanel() || first.rotation != rotation) return false;
+
+    for (size_t i = 1; i < moves_.size(); ++i)
+    {
+      const auto& move = moves_[i];
+      if (!sim.getNextPanel() || sim.hand_panel != move.panel) return false;
+      if (!sim.canPutHandPanel(move.position, move.rotation)) return false;
+
+      sim.hand_rotation = move.rotation;
+      sim.putHandPanel(move.position);
+      sim.checkCompleted(move.position);
+    }
+
+    return true;
+  }
+
+
+private:
+  uint32_t seed_ = 0;
+  u_int flags_   = 0;
+
+  std::vector<Move> moves_;
+};
+
+}
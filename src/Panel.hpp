@@ -5,7 +5,8 @@
 //
 
 #include <vector>
-#include "Utility.hpp"
+#include <array>
+#include "Misc.hpp"
 
 
 namespace ngs {
@@ -33,167 +34,241 @@ struct Panel {
     BUILDING    = TOWN | CASTLE | FORT    // PATH完成とみなす建築物
   };
 
-  Panel(u_int attribute, u_int edge_up, u_int edge_right, u_int edge_bottom, u_int edge_left) noexcept
-    : attribute_(attribute),
-      edge_(4)
+  constexpr Panel(u_int attribute, u_int edge_up, u_int edge_right, u_int edge_bottom, u_int edge_left) noexcept
+    : Panel(attribute, {{ edge_bottom, edge_right, edge_up, edge_left }})
   {
-    edge_[0] = edge_bottom;
-    edge_[1] = edge_right;
-    edge_[2] = edge_up;
-    edge_[3] = edge_left;
-
-    uint64_t edge = 0;
-    for (u_int i = 0; i < edge_.size(); ++i)
-    {
-      edge |= uint64_t(edge_[i] & Panel::EDGE_MASK) << (16 * i);
-    }
-    edge_bundled_ = edge;
   }
 
   ~Panel() = default;
 
 
-  u_int getAttribute() const noexcept
+  constexpr u_int getAttribute() const noexcept
   {
     return attribute_;
   }
 
-  const std::vector<u_int>& getEdge() const noexcept
+  constexpr const std::array<u_int, 4>& getEdge() const noexcept
   {
-    return edge_;
+    return rotated_edge_[0];
   }
 
-  uint64_t getEdgeBundled() const noexcept
+  constexpr uint64_t getEdgeBundled() const noexcept
   {
-    return edge_bundled_;
+    return rotated_value_[0];
   }
 
   // 回転ずみの端情報
-  std::vector<u_int> getRotatedEdge(u_int rotation) const noexcept
+  constexpr const std::array<u_int, 4>& getRotatedEdge(u_int rotation) const noexcept
   {
-    std::vector<u_int> edge = edge_;
-
-    // 左方向へのシフト
-    std::rotate(std::begin(edge), std::begin(edge) + rotation, std::end(edge));
-    return edge;
+    return rotated_edge_[rotation];
   }
 
   // uint64_t で返す
-  uint64_t getRotatedEdgeValue(u_int rotation) const noexcept
+  constexpr uint64_t getRotatedEdgeValue(u_int rotation) const noexcept
   {
-    return rotateRight(edge_bundled_, rotation * 16);
+    return rotated_value_[rotation];
   }
 
 
 private:
+  constexpr Panel(u_int attribute, const std::array<u_int, 4>& edge) noexcept
+    : attribute_(attribute),
+      rotated_edge_{{ rotateEdge(edge, 0), rotateEdge(edge, 1), rotateEdge(edge, 2), rotateEdge(edge, 3) }},
+      rotated_value_{{ bundleEdge(rotateEdge(edge, 0)), bundleEdge(rotateEdge(edge, 1)),
+                       bundleEdge(rotateEdge(edge, 2)), bundleEdge(rotateEdge(edge, 3)) }}
+  {
+  }
+
+  // 左方向へのシフト
+  static constexpr std::array<u_int, 4> rotateEdge(const std::array<u_int, 4>& edge, u_int rotation) noexcept
+  {
+    return {{ edge[rotation % 4], edge[(rotation + 1) % 4], edge[(rotation + 2) % 4], edge[(rotation + 3) % 4] }};
+  }
+
+  // ４辺を１つの値にまとめる
+  static constexpr uint64_t bundleEdge(const std::array<u_int, 4>& edge) noexcept
+  {
+    return  uint64_t(edge[0] & Panel::EDGE_MASK)
+         | (uint64_t(edge[1] & Panel::EDGE_MASK) << 16)
+         | (uint64_t(edge[2] & Panel::EDGE_MASK) << 32)
+         | (uint64_t(edge[3] & Panel::EDGE_MASK) << 48);
+  }
+
+
   u_int attribute_;
-  std::vector<u_int> edge_;     // ４辺の構造
-  uint64_t edge_bundled_;       // ４辺の構造(１つにまとめた値)
+  // TIPS ４方向に回転した端情報をコンパイル時に計算しておく
+  std::array<std::array<u_int, 4>, 4> rotated_edge_;
+  std::array<uint64_t, 4> rotated_value_;
 
 };
 
 
-// 初期パネル生成
-std::vector<Panel> createPanels() noexcept
+// 全パネル
+constexpr Panel panel_catalogue[] = {
+  // a
+  { Panel::DEEP_FOREST, Panel::GRASS,  Panel::FOREST, Panel::FOREST, Panel::FOREST },
+  { 0, Panel::PATH,   Panel::PATH,   Panel::FOREST, Panel::FOREST },
+  { Panel::TOWN, Panel::FOREST | Panel::EDGE, Panel::PATH | Panel::EDGE,   Panel::PATH | Panel::EDGE,   Panel::PATH | Panel::EDGE },
+  { 0, Panel::GRASS,  Panel::GRASS,  Panel::PATH,   Panel::PATH },
+  
+  { 0, Panel::FOREST | Panel::EDGE, Panel::GRASS,  Panel::GRASS, Panel::GRASS },
+  { 0, Panel::FOREST, Panel::FOREST, Panel::GRASS, Panel::GRASS },
+  { 0, Panel::PATH,   Panel::PATH,   Panel::GRASS, Panel::FOREST | Panel::EDGE },
+  { 0, Panel::PATH,   Panel::GRASS,  Panel::GRASS, Panel::PATH },
+  
+  { 0, Panel::GRASS, Panel::FOREST | Panel::EDGE, Panel::GRASS, Panel::FOREST | Panel::EDGE },
+  { 0, Panel::GRASS, Panel::PATH,   Panel::PATH,  Panel::FOREST | Panel::EDGE },
+  { 0, Panel::GRASS, Panel::PATH,   Panel::GRASS, Panel::PATH },
+  { 0, Panel::GRASS, Panel::GRASS,  Panel::PATH,  Panel::PATH },
+
+  // a
+  { Panel::DEEP_FOREST, Panel::GRASS,  Panel::FOREST, Panel::FOREST, Panel::FOREST },
+  { 0, Panel::PATH,   Panel::PATH,   Panel::FOREST, Panel::FOREST },
+  { Panel::TOWN, Panel::FOREST | Panel::EDGE, Panel::PATH | Panel::EDGE,   Panel::PATH | Panel::EDGE,   Panel::PATH | Panel::EDGE },
+  { 0, Panel::GRASS,  Panel::GRASS,  Panel::PATH,   Panel::PATH },
+
+  { 0, Panel::FOREST | Panel::EDGE, Panel::GRASS,  Panel::GRASS, Panel::GRASS },
+  { 0, Panel::FOREST, Panel::FOREST, Panel::GRASS, Panel::GRASS },
+  { 0, Panel::PATH,   Panel::PATH,   Panel::GRASS, Panel::FOREST | Panel::EDGE },
+  { 0, Panel::PATH,   Panel::GRASS,  Panel::GRASS, Panel::PATH },
+  
+  { 0, Panel::GRASS, Panel::FOREST | Panel::EDGE, Panel::GRASS, Panel::FOREST | Panel::EDGE },
+  { 0, Panel::GRASS, Panel::PATH,   Panel::PATH,  Panel::FOREST | Panel::EDGE },
+  { 0, Panel::GRASS, Panel::PATH,   Panel::GRASS, Panel::PATH },
+  { 0, Panel::GRASS, Panel::GRASS,  Panel::PATH,  Panel::PATH },
+
+  // a
+  { Panel::DEEP_FOREST, Panel::GRASS,  Panel::FOREST, Panel::FOREST, Panel::FOREST },
+  { 0, Panel::PATH,   Panel::PATH,   Panel::FOREST, Panel::FOREST },
+  { Panel::TOWN, Panel::FOREST | Panel::EDGE, Panel::PATH | Panel::EDGE,   Panel::PATH | Panel::EDGE,   Panel::PATH | Panel::EDGE },
+  { 0, Panel::GRASS,  Panel::GRASS,  Panel::PATH,   Panel::PATH },
+
+  { 0, Panel::FOREST | Panel::EDGE, Panel::GRASS,  Panel::GRASS, Panel::GRASS },
+  { 0, Panel::FOREST, Panel::FOREST, Panel::GRASS, Panel::GRASS },
+  { 0, Panel::PATH,   Panel::PATH,   Panel::GRASS, Panel::FOREST | Panel::EDGE },
+  { 0, Panel::PATH,   Panel::GRASS,  Panel::GRASS, Panel::PATH },
+  
+  { 0, Panel::GRASS, Panel::FOREST | Panel::EDGE, Panel::GRASS, Panel::FOREST | Panel::EDGE },
+  { 0, Panel::GRASS, Panel::PATH,   Panel::PATH,  Panel::FOREST | Panel::EDGE },
+  { 0, Panel::GRASS, Panel::PATH,   Panel::GRASS, Panel::PATH },
+  { 0, Panel::GRASS, Panel::GRASS,  Panel::PATH,  Panel::PATH },
+
+  // d
+  { 0, Panel::GRASS,  Panel::PATH,   Panel::GRASS,  Panel::PATH },
+  { Panel::TOWN, Panel::GRASS,  Panel::PATH | Panel::EDGE,   Panel::PATH | Panel::EDGE,   Panel::PATH | Panel::EDGE },
+  { Panel::DEEP_FOREST, Panel::FOREST, Panel::FOREST, Panel::FOREST, Panel::PATH | Panel::EDGE },
+  { 0, Panel::GRASS,  Panel::FOREST, Panel::GRASS,  Panel::FOREST },
+  
+  { Panel::CHURCH, Panel::GRASS,  Panel::GRASS,  Panel::GRASS, Panel::GRASS },
+  { 0, Panel::PATH, Panel::FOREST | Panel::EDGE, Panel::PATH,  Panel::GRASS },
+  { 0, Panel::FOREST, Panel::GRASS,  Panel::GRASS, Panel::FOREST },
+  { Panel::CHURCH, Panel::GRASS,  Panel::GRASS,  Panel::GRASS, Panel::GRASS },
+ 
+  { 0, Panel::GRASS, Panel::PATH,   Panel::GRASS,  Panel::PATH },
+  { Panel::TOWN, Panel::PATH | Panel::EDGE,  Panel::PATH | Panel::EDGE,   Panel::GRASS,  Panel::PATH | Panel::EDGE },
+  { Panel::FOREST, Panel::GRASS, Panel::GRASS,  Panel::GRASS,  Panel::PATH | Panel::EDGE },
+  { 0, Panel::GRASS, Panel::FOREST | Panel::EDGE, Panel::FOREST | Panel::EDGE, Panel::GRASS },
+
+  // d
+  { 0, Panel::GRASS,  Panel::PATH,   Panel::GRASS,  Panel::PATH },
+  { Panel::TOWN, Panel::GRASS,  Panel::PATH | Panel::EDGE,   Panel::PATH | Panel::EDGE,   Panel::PATH | Panel::EDGE },
+  { Panel::DEEP_FOREST, Panel::FOREST, Panel::FOREST, Panel::FOREST, Panel::PATH | Panel::EDGE },
+  { 0, Panel::GRASS,  Panel::FOREST, Panel::GRASS,  Panel::FOREST },
+  
+  { Panel::CHURCH, Panel::GRASS,  Panel::GRASS,  Panel::GRASS, Panel::GRASS },
+  { 0, Panel::PATH, Panel::FOREST | Panel::EDGE, Panel::PATH,  Panel::GRASS },
+  { 0, Panel::FOREST, Panel::GRASS,  Panel::GRASS, Panel::FOREST },
+  { Panel::CHURCH, Panel::GRASS,  Panel::GRASS,  Panel::GRASS, Panel::GRASS },
+
+  { 0, Panel::GRASS, Panel::PATH,   Panel::GRASS,  Panel::PATH },
+  { Panel::TOWN, Panel::PATH | Panel::EDGE,  Panel::PATH | Panel::EDGE,   Panel::GRASS,  Panel::PATH | Panel::EDGE },
+  { Panel::FOREST, Panel::GRASS, Panel::GRASS,  Panel::GRASS,  Panel::PATH | Panel::EDGE },
+  { 0, Panel::GRASS, Panel::FOREST | Panel::EDGE, Panel::FOREST | Panel::EDGE, Panel::GRASS },
+
+  // f 
+  { 0, Panel::PATH,   Panel::FOREST, Panel::FOREST, Panel::PATH },
+  { Panel::DEEP_FOREST, Panel::FOREST, Panel::GRASS,  Panel::FOREST, Panel::FOREST },
+  { 0, Panel::GRASS,  Panel::GRASS,  Panel::FOREST | Panel::EDGE, Panel::GRASS },
+  { 0, Panel::PATH, Panel::FOREST | Panel::EDGE, Panel::PATH,   Panel::GRASS },
+  
+  { 0, Panel::FOREST, Panel::FOREST, Panel::PATH,   Panel::PATH },
+  { Panel::DEEP_FOREST, Panel::FOREST, Panel::FOREST, Panel::FOREST, Panel::FOREST },
+  { Panel::DEEP_FOREST, Panel::FOREST, Panel::PATH | Panel::EDGE,   Panel::FOREST, Panel::FOREST },
+  { Panel::CASTLE, Panel::PATH | Panel::EDGE,   Panel::PATH | Panel::EDGE,   Panel::PATH | Panel::EDGE,   Panel::PATH | Panel::EDGE },
+
+  { 0, Panel::PATH, Panel::GRASS, Panel::PATH, Panel::GRASS },
+  { 0, Panel::FOREST, Panel::GRASS, Panel::FOREST, Panel::GRASS },
+  { 0, Panel::FOREST | Panel::EDGE, Panel::GRASS, Panel::GRASS, Panel::GRASS },
+  { Panel::START, Panel::PATH, Panel::FOREST | Panel::EDGE, Panel::PATH, Panel::GRASS },
+};
+
+
+// パネル定義の検証
+namespace PanelCheck {
+
+// 開始パネルの枚数
+constexpr int countStartPanel() noexcept
 {
-  static const std::vector<Panel> panels = {
-    // a
-    { Panel::DEEP_FOREST, Panel::GRASS,  Panel::FOREST, Panel::FOREST, Panel::FOREST },
-    { 0, Panel::PATH,   Panel::PATH,   Panel::FOREST, Panel::FOREST },
-    { Panel::TOWN, Panel::FOREST | Panel::EDGE, Panel::PATH | Panel::EDGE,   Panel::PATH | Panel::EDGE,   Panel::PATH | Panel::EDGE },
-    { 0, Panel::GRASS,  Panel::GRASS,  Panel::PATH,   Panel::PATH },
-    
-    { 0, Panel::FOREST | Panel::EDGE, Panel::GRASS,  Panel::GRASS, Panel::GRASS },
-    { 0, Panel::FOREST, Panel::FOREST, Panel::GRASS, Panel::GRASS },
-    { 0, Panel::PATH,   Panel::PATH,   Panel::GRASS, Panel::FOREST | Panel::EDGE },
-    { 0, Panel::PATH,   Panel::GRASS,  Panel::GRASS, Panel::PATH },
-    
-    { 0, Panel::GRASS, Panel::FOREST | Panel::EDGE, Panel::GRASS, Panel::FOREST | Panel::EDGE },
-    { 0, Panel::GRASS, Panel::PATH,   Panel::PATH,  Panel::FOREST | Panel::EDGE },
-    { 0, Panel::GRASS, Panel::PATH,   Panel::GRASS, Panel::PATH },
-    { 0, Panel::GRASS, Panel::GRASS,  Panel::PATH,  Panel::PATH },
-
-    // a
-    { Panel::DEEP_FOREST, Panel::GRASS,  Panel::FOREST, Panel::FOREST, Panel::FOREST },
-    { 0, Panel::PATH,   Panel::PATH,   Panel::FOREST, Panel::FOREST },
-    { Panel::TOWN, Panel::FOREST | Panel::EDGE, Panel::PATH | Panel::EDGE,   Panel::PATH | Panel::EDGE,   Panel::PATH | Panel::EDGE },
-    { 0, Panel::GRASS,  Panel::GRASS,  Panel::PATH,   Panel::PATH },
-
-    { 0, Panel::FOREST | Panel::EDGE, Panel::GRASS,  Panel::GRASS, Panel::GRASS },
-    { 0, Panel::FOREST, Panel::FOREST, Panel::GRASS, Panel::GRASS },
-    { 0, Panel::PATH,   Panel::PATH,   Panel::GRASS, Panel::FOREST | Panel::EDGE },
-    { 0, Panel::PATH,   Panel::GRASS,  Panel::GRASS, Panel::PATH },
-    
-    { 0, Panel::GRASS, Panel::FOREST | Panel::EDGE, Panel::GRASS, Panel::FOREST | Panel::EDGE },
-    { 0, Panel::GRASS, Panel::PATH,   Panel::PATH,  Panel::FOREST | Panel::EDGE },
-    { 0, Panel::GRASS, Panel::PATH,   Panel::GRASS, Panel::PATH },
-    { 0, Panel::GRASS, Panel::GRASS,  Panel::PATH,  Panel::PATH },
-
-    // a
-    { Panel::DEEP_FOREST, Panel::GRASS,  Panel::FOREST, Panel::FOREST, Panel::FOREST },
-    { 0, Panel::PATH,   Panel::PATH,   Panel::FOREST, Panel::FOREST },
-    { Panel::TOWN, Panel::FOREST | Panel::EDGE, Panel::PATH | Panel::EDGE,   Panel::PATH | Panel::EDGE,   Panel::PATH | Panel::EDGE },
-    { 0, Panel::GRASS,  Panel::GRASS,  Panel::PATH,   Panel::PATH },
-
-    { 0, Panel::FOREST | Panel::EDGE, Panel::GRASS,  Panel::GRASS, Panel::GRASS },
-    { 0, Panel::FOREST, Panel::FOREST, Panel::GRASS, Panel::GRASS },
-    { 0, Panel::PATH,   Panel::PATH,   Panel::GRASS, Panel::FOREST | Panel::EDGE },
-    { 0, Panel::PATH,   Panel::GRASS,  Panel::GRASS, Panel::PATH },
-    
-    { 0, Panel::GRASS, Panel::FOREST | Panel::EDGE, Panel::GRASS, Panel::FOREST | Panel::EDGE },
-    { 0, Panel::GRASS, Panel::PATH,   Panel::PATH,  Panel::FOREST | Panel::EDGE },
-    { 0, Panel::GRASS, Panel::PATH,   Panel::GRASS, Panel::PATH },
-    { 0, Panel::GRASS, Panel::GRASS,  Panel::PATH,  Panel::PATH },
-
-    // d
-    { 0, Panel::GRASS,  Panel::PATH,   Panel::GRASS,  Panel::PATH },
-    { Panel::TOWN, Panel::GRASS,  Panel::PATH | Panel::EDGE,   Panel::PATH | Panel::EDGE,   Panel::PATH | Panel::EDGE },
-    { Panel::DEEP_FOREST, Panel::FOREST, Panel::FOREST, Panel::FOREST, Panel::PATH | Panel::EDGE },
-    { 0, Panel::GRASS,  Panel::FOREST, Panel::GRASS,  Panel::FOREST },
-    
-    { Panel::CHURCH, Panel::GRASS,  Panel::GRASS,  Panel::GRASS, Panel::GRASS },
-    { 0, Panel::PATH, Panel::FOREST | Panel::EDGE, Panel::PATH,  Panel::GRASS },
-    { 0, Panel::FOREST, Panel::GRASS,  Panel::GRASS, Panel::FOREST },
-    { Panel::CHURCH, Panel::GRASS,  Panel::GRASS,  Panel::GRASS, Panel::GRASS },
-   
-    { 0, Panel::GRASS, Panel::PATH,   Panel::GRASS,  Panel::PATH },
-    { Panel::TOWN, Panel::PATH | Panel::EDGE,  Panel::PATH | Panel::EDGE,   Panel::GRASS,  Panel::PATH | Panel::EDGE },
-    { Panel::FOREST, Panel::GRASS, Panel::GRASS,  Panel::GRASS,  Panel::PATH | Panel::EDGE },
-    { 0, Panel::GRASS, Panel::FOREST | Panel::EDGE, Panel::FOREST | Panel::EDGE, Panel::GRASS },
-
-    // d
-    { 0, Panel::GRASS,  Panel::PATH,   Panel::GRASS,  Panel::PATH },
-    { Panel::TOWN, Panel::GRASS,  Panel::PATH | Panel::EDGE,   Panel::PATH | Panel::EDGE,   Panel::PATH | Panel::EDGE },
-    { Panel::DEEP_FOREST, Panel::FOREST, Panel::FOREST, Panel::FOREST, Panel::PATH | Panel::EDGE },
-    { 0, Panel::GRASS,  Panel::FOREST, Panel::GRASS,  Panel::FOREST },
-    
-    { Panel::CHURCH, Panel::GRASS,  Panel::GRASS,  Panel::GRASS, Panel::GRASS },
-    { 0, Panel::PATH, Panel::FOREST | Panel::EDGE, Panel::PATH,  Panel::GRASS },
-    { 0, Panel::FOREST, Panel::GRASS,  Panel::GRASS, Panel::FOREST },
-    { Panel::CHURCH, Panel::GRASS,  Panel::GRASS,  Panel::GRASS, Panel::GRASS },
-
-    { 0, Panel::GRASS, Panel::PATH,   Panel::GRASS,  Panel::PATH },
-    { Panel::TOWN, Panel::PATH | Panel::EDGE,  Panel::PATH | Panel::EDGE,   Panel::GRASS,  Panel::PATH | Panel::EDGE },
-    { Panel::FOREST, Panel::GRASS, Panel::GRASS,  Panel::GRASS,  Panel::PATH | Panel::EDGE },
-    { 0, Panel::GRASS, Panel::FOREST | Panel::EDGE, Panel::FOREST | Panel::EDGE, Panel::GRASS },
-
-    // f 
-    { 0, Panel::PATH,   Panel::FOREST, Panel::FOREST, Panel::PATH },
-    { Panel::DEEP_FOREST, Panel::FOREST, Panel::GRASS,  Panel::FOREST, Panel::FOREST },
-    { 0, Panel::GRASS,  Panel::GRASS,  Panel::FOREST | Panel::EDGE, Panel::GRASS },
-    { 0, Panel::PATH, Panel::FOREST | Panel::EDGE, Panel::PATH,   Panel::GRASS },
-    
-    { 0, Panel::FOREST, Panel::FOREST, Panel::PATH,   Panel::PATH },
-    { Panel::DEEP_FOREST, Panel::FOREST, Panel::FOREST, Panel::FOREST, Panel::FOREST },
-    { Panel::DEEP_FOREST, Panel::FOREST, Panel::PATH | Panel::EDGE,   Panel::FOREST, Panel::FOREST },
-    { Panel::CASTLE, Panel::PATH | Panel::EDGE,   Panel::PATH | Panel::EDGE,   Panel::PATH | Panel::EDGE,   Panel::PATH | Panel::EDGE },
-
-    { 0, Panel::PATH, Panel::GRASS, Panel::PATH, Panel::GRASS },
-    { 0, Panel::FOREST, Panel::GRASS, Panel::FOREST, Panel::GRASS },
-    { 0, Panel::FOREST | Panel::EDGE, Panel::GRASS, Panel::GRASS, Panel::GRASS },
-    { Panel::START, Panel::PATH, Panel::FOREST | Panel::EDGE, Panel::PATH, Panel::GRASS },
-  };
+  int count = 0;
+  for (const auto& panel : panel_catalogue)
+  {
+    if (panel.getAttribute() & Panel::START) ++count;
+  }
+  return count;
+}
+
+// 属性の辺は全て端か、全て途中か(Regionが前提にしている)
+constexpr bool isEdgeConsistent(u_int attribute) noexcept
+{
+  for (const auto& panel : panel_catalogue)
+  {
+    const auto& edge = panel.getEdge();
+    int has_attr = 0;
+    int has_edge = 0;
+    for (int i = 0; i < 4; ++i)
+    {
+      if (!(edge[i] & attribute)) continue;
+
+      ++has_attr;
+      if (edge[i] & Panel::EDGE) ++has_edge;
+    }
+    if (has_edge && (has_edge != has_attr)) return false;
+  }
+  return true;
+}
 
+// 回転テーブルが正しいか
+constexpr bool isRotationValid() noexcept
+{
+  for (const auto& panel : panel_catalogue)
+  {
+    for (u_int r = 0; r < 4; ++r)
+    {
+      const auto& edge = panel.getRotatedEdge(r);
+      for (u_int i = 0; i < 4; ++i)
+      {
+        if (edge[i] != panel.getEdge()[(i + r) % 4]) return false;
+        if (((panel.getRotatedEdgeValue(r) >> (16 * i)) & Panel::EDGE_MASK) != (edge[i] & Panel::EDGE_MASK)) return false;
+      }
+    }
+  }
+  return true;
+}
+
+static_assert(elemsof(panel_catalogue) == 72, "Panel count mismatch.");
+static_assert(countStartPanel() == 1, "Start panel must be unique.");
+static_assert(isEdgeConsistent(Panel::PATH),   "PATH edge is inconsistent.");
+static_assert(isEdgeConsistent(Panel::FOREST), "FOREST edge is inconsistent.");
+static_assert(isRotationValid(), "Rotation table is broken.");
+
+}
+
+
+// 初期パネル生成
+// NOTICE 実体は１つだけ
+const std::vector<Panel>& createPanels() noexcept
+{
+  static const std::vector<Panel> panels(std::begin(panel_catalogue), std::end(panel_catalogue));
   return panels;
 }
 
@@ -0,0 +1,107 @@
+﻿#pragma once
+
+//
+// パネルの種類
+//   panel_catalogueには同じパネルが何枚も入っているので、まとめて扱うための表
+//
+//   種類(type) : 属性と端が全く同じパネル。入れ替えてもゲームの結果は変わらない
+//   形(shape)  : 回転すると端の形が重なるパネル。置けるかどうかは形だけで決まる
+//
+
+#include <vector>
+#include <array>
+#include <algorithm>
+#include "Panel.hpp"
+
+
+namespace ngs {
+
+class PanelTypes
+{
+public:
+  explicit PanelTypes(const std::vector<Panel>& panels) noexcept
+  {
+    std::vector<uint64_t> shapes;
+    for (int i = 0; i < int(panels.size()); ++i)
+    {
+      const auto& panel = panels[i];
+
+      // 種類
+      auto it = std::find_if(std::begin(panels_), std::end(panels_),
+                             [&panels, &panel](int p)
+                             {
+                               return panels[p].getAttribute() == panel.getAttribute()
+                                   && panels[p].getEdge() == panel.getEdge();
+                             });
+      if (it == std::end(panels_))
+      {
+        panels_.push_back(i);
+        it = std::end(panels_) - 1;
+      }
+      types_.push_back(int(it - std::begin(panels_)));
+
+      // 形
+      auto shape = canonicalEdge(panel);
+      auto s = std::find(std::begin(shapes), std::end(shapes), shape);
+      shapes_.push_back(int(s - std::begin(shapes)));
+      if (s == std::end(shapes)) shapes.push_back(shape);
+    }
+    num_shapes_ = shapes.size();
+  }
+
+  ~PanelTypes() = default;
+
+
+  // 種類の数
+  size_t size() const noexcept
+  {
+    return panels_.size();
+  }
+
+  // 形の数
+  size_t shapeSize() const noexcept
+  {
+    return num_shapes_;
+  }
+
+  int getType(int panel) const noexcept
+  {
+    return types_[panel];
+  }
+
+  int getShape(int panel) const noexcept
+  {
+    return shapes_[panel];
+  }
+
+  // 種類の代表(一番若い通し番号)
+  int getPanel(int type) const noexcept
+  {
+    return panels_[type];
+  }
+
+
+  // 回転で正規化した端の形
+  static uint64_t canonicalEdge(const Panel& panel) noexcept
+  {
+    uint64_t edge = panel.getRotatedEdgeValue(0);
+    for (u_int r = 1; r < 4; ++r)
+    {
+      edge = std::min(edge, panel.getRotatedEdgeValue(r));
+    }
+    return edge;
+  }
+
+
+private:
+  // パネルごとの種類と形
+  std::vector<int> types_;
+  std::vector<int> shapes_;
+
+  // 種類ごとの代表
+  std::vector<int> panels_;
+
+  size_t num_shapes_;
+};
+
+}
@@ -13,13 +13,14 @@ namespace ngs { namespace Params {
 
 ci::JsonTree load(const std::string& path)
 {
-  return ci::JsonTree(Asset::load(path));
+  return ci::JsonTree(Asset::loadString(path));
 }
 
 ci::JsonTree loadParams()
 {
 #if defined (OBFUSCATION_PARAMS)
   // 難読化されたファイル→JSON
+  // TIPS ファイルの内容から直接伸長する(大きいファイルはマップする)
   auto text = TextCodec::load(ci::app::getAssetPath("params.data").string());
   return ci::JsonTree(text);
 #else
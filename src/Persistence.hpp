@@ -0,0 +1,298 @@
+﻿#pragma once
+
+//
+// ファイルの書き出しを別スレッドで行う
+//   書き出す内容は呼び出し側で用意して渡す(渡した後は変わらない)
+//   書き出しは１つのスレッドで、頼まれた順に行う
+//   まだ書き出していない同じファイルへの書き出しや追記はまとめる
+//
+// NOTICE 非アクティブになる時と終了時は、全て書き出すまで待つ
+//
+
+#include <deque>
+#include <string>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <fstream>
+#include <cstdio>
+#include <memory>
+#if defined (CINDER_MSW)
+#include <io.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+#include <boost/noncopyable.hpp>
+#include "ConnectionHolder.hpp"
+
+
+namespace ngs {
+
+class Persistence
+  : private boost::noncopyable
+{
+  struct Job
+  {
+    enum Type {
+      WRITE,
+      APPEND,
+      REMOVE,
+      // 任意の処理(前後の書き出しとはまとめない)
+      TASK,
+    };
+
+    Type type;
+    ci::fs::path path;
+    std::string data;
+    std::function<void()> task;
+  };
+
+
+public:
+  Persistence(Event<Arguments>& event) noexcept
+    : worker_(&Persistence::run, this)
+  {
+    holder_ += event.connect("App:ResignActive",
+                             [this](const Connection&, const Arguments&) noexcept
+                             {
+                               flush();
+                             });
+  }
+
+  ~Persistence()
+  {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      finish_ = true;
+    }
+    cond_.notify_all();
+    worker_.join();
+  }
+
+
+  // ファイルを丸ごと書き換える
+  void write(const ci::fs::path& path, std::string data) noexcept
+  {
+    push({ Job::WRITE, path, std::move(data), nullptr });
+  }
+
+  // ファイルの末尾に追記
+  void append(const ci::fs::path& path, std::string data) noexcept
+  {
+    push({ Job::APPEND, path, std::move(data), nullptr });
+  }
+
+  void remove(const ci::fs::path& path) noexcept
+  {
+    push({ Job::REMOVE, path, std::string(), nullptr });
+  }
+
+  // 書き出し用のスレッドで実行する
+  void post(std::function<void()> task) noexcept
+  {
+    push({ Job::TASK, ci::fs::path(), std::string(), std::move(task) });
+  }
+
+  // 頼まれた書き出しが全て終わるまで待つ
+  void flush() noexcept
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    cond_.wait(lock,
+               [this]()
+               {
+                 return jobs_.empty() && !busy_;
+               });
+  }
+
+  // 指定したファイルへの書き出しが終わるまで待つ
+  // TIPS 書き出しを頼んだ直後に読む時に使う
+  void flush(const ci::fs::path& path) noexcept
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    cond_.wait(lock,
+               [this, &path]()
+               {
+                 if (busy_ && busy_path_ == path) return false;
+                 for (const auto& job : jobs_)
+                 {
+                   if (job.path == path) return false;
+                 }
+                 return true;
+               });
+  }
+
+
+  // 一時ファイルに書いてから置き換える
+  // TIPS 途中で終わっても元のファイルか新しいファイルのどちらかが残る
+  // NOTICE 置き換える前に内容をディスクまで書き出す
+  //        (書き出す前に電源が落ちると、新しい名前が空のファイルを指すことがある)
+  static bool writeFile(const ci::fs::path& path, const std::string& data) noexcept
+  {
+    auto temp_path = ci::fs::path(path.string() + ".tmp");
+    if (!writeSync(temp_path, data))
+    {
+      DOUT << "Persistence:write failed: " << temp_path << std::endl;
+      removeFile(temp_path);
+      return false;
+    }
+
+    try
+    {
+      ci::fs::rename(temp_path, path);
+    }
+    catch (ci::fs::filesystem_error& ex)
+    {
+      DOUT << ex.what() << std::endl;
+      removeFile(temp_path);
+      return false;
+    }
+    return true;
+  }
+
+
+private:
+  void push(Job job) noexcept
+  {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+
+      // 同じファイルへの、まだ書き出していない最後の書き出しにまとめる
+      if (job.type == Job::WRITE || job.type == Job::APPEND)
+      {
+        for (auto it = jobs_.rbegin(); it != jobs_.rend(); ++it)
+        {
+          if (it->type == Job::TASK) break;
+          if (it->path != job.path) continue;
+
+          if (it->type == job.type)
+          {
+            if (job.type == Job::WRITE)
+            {
+              it->data = std::move(job.data);
+            }
+            else
+            {
+              it->data += job.data;
+            }
+            return;
+          }
+          break;
+        }
+      }
+
+      jobs_.push_back(std::move(job));
+    }
+    cond_.notify_all();
+  }
+
+  void run() noexcept
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true)
+    {
+      cond_.wait(lock,
+                 [this]()
+                 {
+                   return !jobs_.empty() || finish_;
+                 });
+      // NOTICE 終了時も残っている書き出しは済ませる
+      if (jobs_.empty()) break;
+
+      auto job = std::move(jobs_.front());
+      jobs_.pop_front();
+      busy_      = true;
+      busy_path_ = job.path;
+
+      lock.unlock();
+      execute(job);
+      lock.lock();
+
+      busy_ = false;
+      cond_.notify_all();
+    }
+  }
+
+  static void execute(const Job& job) noexcept
+  {
+    switch (job.type)
+    {
+    case Job::WRITE:
+      writeFile(job.path, job.data);
+      break;
+
+    case Job::APPEND:
+      {
+        std::ofstream fstr(job.path.string(), std::ios::binary | std::ios::app);
+        fstr.write(job.data.data(), job.data.size());
+        fstr.flush();
+        if (!fstr)
+        {
+          DOUT << "Persistence:append failed: " << job.path << std::endl;
+        }
+      }
+      break;
+
+    case Job::REMOVE:
+      DOUT << "remove: " << job.path << std::endl;
+      removeFile(job.path);
+      break;
+
+    case Job::TASK:
+      job.task();
+      break;
+    }
+  }
+
+
+  // 書き出して、ディスクへの書き出しが終わるまで待つ
+  static bool writeSync(const ci::fs::path& path, const std::string& data) noexcept
+  {
+    std::unique_ptr<std::FILE, int (*)(std::FILE*)> fp(std::fopen(path.string().c_str(), "wb"), std::fclose);
+    if (!fp) return false;
+
+    if (std::fwrite(data.data(), 1, data.size(), fp.get()) != data.size()) return false;
+    if (std::fflush(fp.get()) != 0) return false;
+
+#if defined (CINDER_MSW)
+    if (_commit(_fileno(fp.get())) != 0) return false;
+#elif defined (F_FULLFSYNC)
+    // TIPS macOS/iOSのfsyncはディスクのキャッシュまでは書き出さない
+    if (fcntl(fileno(fp.get()), F_FULLFSYNC) != 0 && fsync(fileno(fp.get())) != 0) return false;
+#else
+    if (fsync(fileno(fp.get())) != 0) return false;
+#endif
+
+    return std::fclose(fp.release()) == 0;
+  }
+
+  static void removeFile(const ci::fs::path& path) noexcept
+  {
+    try
+    {
+      ci::fs::remove(path);
+    }
+    catch (ci::fs::filesystem_error& ex)
+    {
+      DOUT << ex.what() << std::endl;
+    }
+  }
+
+
+  std::mutex mutex_;
+  std::condition_variable cond_;
+
+  std::deque<Job> jobs_;
+  bool busy_   = false;
+  bool finish_ = false;
+  // 書き出し中のファイル
+  ci::fs::path busy_path_;
+
+  ConnectionHolder holder_;
+
+  // NOTICE 他のメンバーより後に初期化する
+  std::thread worker_;
+};
+
+}
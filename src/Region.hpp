@@ -0,0 +1,486 @@
+﻿#pragma once
+
+//
+// 森や道の繋がりを管理
+//   パネルの辺を要素にしたUnion-Find
+//   閉じていない辺の数が０になった領域が完成
+//   書き換えを記録しておけば、記録した所まで巻き戻せる
+//   要素はパネルごとの枠に置き、完成した領域の要素だけになった枠は使い回す
+//
+
+#include <vector>
+#include "Panel.hpp"
+#include "Field.hpp"
+
+
+namespace ngs {
+
+struct Region
+{
+  Region(u_int attribute) noexcept
+    : attribute_(attribute)
+  {
+  }
+
+  ~Region() = default;
+
+
+  // パネルを追加
+  // NOTICE Field::addPanelの後に呼ぶ
+  void addPanel(const glm::ivec2& pos, const Field& field, const std::vector<Panel>& panels) noexcept
+  {
+    auto index = field.getPanelIndex(pos);
+    assert(index >= 0);
+    if (slot_.size() <= size_t(index)) slot_.resize(index + 1, -1);
+
+    const auto& status = field.getPanelStatus(pos);
+    const auto& panel  = panels[status.number];
+    const auto& edge   = panel.getRotatedEdge(status.rotation);
+
+    // 属性を持つ辺があるパネルだけ枠を確保
+    int num = 0;
+    for (u_int i = 0; i < 4; ++i)
+    {
+      if (edge[i] & attribute_) ++num;
+    }
+    int slot = (num > 0) ? allocateSlot(index, num) : -1;
+
+    int first = -1;
+    for (u_int i = 0; i < 4; ++i)
+    {
+      auto p = pos + offsets()[i];
+      auto neighbor = field.getPanelIndex(p);
+      // 隣のパネルの向かい合った辺は閉じる
+      if (neighbor >= 0)
+      {
+        int node = getNode(neighbor, (i + 2) % 4);
+        if (node >= 0 && parent_[node] >= 0)
+        {
+          auto root = find(node);
+          write(open_, OPEN, root, open_[root] - 1);
+        }
+      }
+
+      if (!(edge[i] & attribute_)) continue;
+
+      int node = slot * 4 + i;
+      write(parent_, PARENT, node, node);
+      write(size_,   SIZE,   node, 1);
+      write(open_,   OPEN,   node, (neighbor < 0) ? 1 : 0);
+      write(next_,   NEXT,   node, node);
+
+      if ((edge[i] & Panel::EDGE) == 0)
+      {
+        // 端でない辺はパネル内で繋がっている
+        if (first < 0)
+        {
+          first = node;
+          if ((attribute_ & Panel::FOREST) && (panel.getAttribute() & Panel::DEEP_FOREST)) write(deep_, DEEP, node, 1);
+        }
+        else
+        {
+          unite(first, node);
+        }
+      }
+    }
+    if (slot < 0) return;
+
+    // 隣のパネルと繋げる
+    for (u_int i = 0; i < 4; ++i)
+    {
+      int node = slot * 4 + i;
+      if (parent_[node] < 0) continue;
+
+      auto neighbor = field.getPanelIndex(pos + offsets()[i]);
+      if (neighbor < 0) continue;
+
+      int other = getNode(neighbor, (i + 2) % 4);
+      if (other >= 0 && parent_[other] >= 0) unite(node, other);
+    }
+  }
+
+  // 指定位置のパネルを含む領域が完成したか調べる
+  // NOTICE isCompleteAttributeと同じ順序で結果を返す
+  std::vector<std::vector<glm::ivec2>> isComplete(const glm::ivec2& pos,
+                                                  const Field& field, const std::vector<Panel>& panels) noexcept
+  {
+    std::vector<std::vector<glm::ivec2>> completed;
+    completed_deep_.clear();
+
+    auto slot = slot_[field.getPanelIndex(pos)];
+    if (slot < 0) return completed;
+
+    const auto& status = field.getPanelStatus(pos);
+    const auto& edge   = panels[status.number].getRotatedEdge(status.rotation);
+
+    // 端を含まないパネルは１つの領域
+    bool has_edge = false;
+    for (u_int i = 0; i < 4; ++i)
+    {
+      if ((edge[i] & attribute_) && (edge[i] & Panel::EDGE)) has_edge = true;
+    }
+
+    std::vector<int> reported;
+    for (u_int i = 0; i < 4; ++i)
+    {
+      int node = slot * 4 + i;
+      if (parent_[node] < 0) continue;
+
+      auto root = find(node);
+      if (open_[root] > 0) continue;
+      if (std::find(std::begin(reported), std::end(reported), root) != std::end(reported)) continue;
+      reported.push_back(root);
+      completed_deep_.push_back(deep_[root]);
+
+      // 領域を辿ってパネルを列挙
+      std::vector<glm::ivec2> comp;
+      ++stamp_;
+      if (has_edge)
+      {
+        visited_[node] = stamp_;
+        collect(pos + offsets()[i], i, field, panels, comp);
+      }
+      else
+      {
+        visited_[slot * 4] = stamp_;
+        for (u_int j = 0; j < 4; ++j)
+        {
+          if (parent_[slot * 4 + j] < 0) continue;
+          collect(pos + offsets()[j], j, field, panels, comp);
+        }
+      }
+      comp.push_back(pos);
+      completed.push_back(comp);
+    }
+
+    // 完成した領域の要素はもう書き換わらないので畳む
+    // NOTICE 巻き戻せる間は畳まない
+    auto& journal = journal_.value;
+    for (auto root : reported)
+    {
+      if (journal.enabled)
+      {
+        journal.completed.push_back({ root, journal.entries.size() });
+      }
+      else
+      {
+        compact(root);
+      }
+    }
+
+    return completed;
+  }
+
+  // 直前のisCompleteで完成した領域ごとの深い森の数
+  const std::vector<u_int>& getCompletedDeepForest() const noexcept
+  {
+    return completed_deep_;
+  }
+
+
+  // 書き換えの記録を取るか
+  // NOTICE 複製したRegionには記録を引き継がない
+  void setJournal(bool enable) noexcept
+  {
+    auto& journal = journal_.value;
+    // 巻き戻せなくなった完成を畳む
+    for (const auto& c : journal.completed)
+    {
+      compact(c.root);
+    }
+    journal.completed.clear();
+
+    journal.enabled = enable;
+    journal.entries.clear();
+  }
+
+  // 記録した書き換えの数(rollbackに渡す)
+  size_t getJournalSize() const noexcept
+  {
+    return journal_.value.entries.size();
+  }
+
+  // 先頭からsize個の記録を捨てる(もう戻さない)
+  void dropJournal(size_t size) noexcept
+  {
+    auto& journal = journal_.value;
+    auto& entries = journal.entries;
+    assert(size <= entries.size());
+    entries.erase(std::begin(entries), std::begin(entries) + size);
+
+    // 捨てた記録の間に完成した領域は畳む
+    auto& completed = journal.completed;
+    auto it = std::begin(completed);
+    for (; it != std::end(completed) && it->journal <= size; ++it)
+    {
+      compact(it->root);
+    }
+    completed.erase(std::begin(completed), it);
+    for (auto& c : completed)
+    {
+      c.journal -= size;
+    }
+  }
+
+  // 記録した書き換えをsizeの時点まで戻す
+  void rollback(size_t size) noexcept
+  {
+    auto& journal = journal_.value;
+    auto& entries = journal.entries;
+    assert(size <= entries.size());
+    while (entries.size() > size)
+    {
+      const auto& entry = entries.back();
+      switch (entry.array)
+      {
+      case PARENT: parent_[entry.index] = entry.value;        break;
+      case SIZE:   size_[entry.index]   = entry.value;        break;
+      case OPEN:   open_[entry.index]   = entry.value;        break;
+      case DEEP:   deep_[entry.index]   = u_int(entry.value); break;
+      case NEXT:   next_[entry.index]   = entry.value;        break;
+
+      case SLOT:
+        // 確保した枠を返す
+        free_slots_.push_back(slot_[entry.index]);
+        slot_[entry.index] = entry.value;
+        break;
+      }
+      entries.pop_back();
+    }
+
+    // 無かったことになった完成
+    auto& completed = journal.completed;
+    while (!completed.empty() && completed.back().journal > size)
+    {
+      completed.pop_back();
+    }
+  }
+
+
+private:
+  // 時計回り
+  static const glm::ivec2* offsets() noexcept
+  {
+    static const glm::ivec2 offsets[] = {
+      {  0,  1 },
+      {  1,  0 },
+      {  0, -1 },
+      { -1,  0 },
+    };
+    return offsets;
+  }
+
+  // 書き換える配列
+  enum Array {
+    PARENT,
+    SIZE,
+    OPEN,
+    DEEP,
+    NEXT,
+    // パネルの枠(indexはパネルの置いた順番)
+    SLOT,
+  };
+
+  // 元の値を記録してから書き換える
+  template <typename T>
+  void write(std::vector<T>& array, Array id, int index, typename std::vector<T>::value_type value) noexcept
+  {
+    auto& journal = journal_.value;
+    if (journal.enabled) journal.entries.push_back({ id, index, int(array[index]) });
+    array[index] = value;
+  }
+
+  // パネルの辺の要素(無ければ-1)
+  int getNode(int index, u_int direction) const noexcept
+  {
+    if (size_t(index) >= slot_.size()) return -1;
+    auto slot = slot_[index];
+    return (slot < 0) ? -1 : slot * 4 + int(direction);
+  }
+
+  // パネルの枠を確保
+  // num: 属性を持つ辺の数
+  // TIPS 空いている枠があれば使い回す
+  int allocateSlot(int index, int num) noexcept
+  {
+    int slot;
+    if (free_slots_.empty())
+    {
+      slot = int(owner_.size());
+      owner_.push_back(index);
+      live_.push_back(num);
+
+      size_t size = (slot + 1) * 4;
+      parent_.resize(size, -1);
+      size_.resize(size, 0);
+      open_.resize(size, 0);
+      deep_.resize(size, 0);
+      next_.resize(size, -1);
+      visited_.resize(size, 0);
+    }
+    else
+    {
+      slot = free_slots_.back();
+      free_slots_.pop_back();
+      owner_[slot] = index;
+      live_[slot]  = num;
+
+      for (int i = slot * 4; i < (slot + 1) * 4; ++i)
+      {
+        parent_[i]  = -1;
+        deep_[i]    = 0;
+        visited_[i] = 0;
+      }
+    }
+
+    auto& journal = journal_.value;
+    if (journal.enabled) journal.entries.push_back({ SLOT, index, slot_[index] });
+    slot_[index] = slot;
+    return slot;
+  }
+
+  // 完成した領域の要素を畳む
+  // 完成した領域の要素だけになったパネルは枠を空ける
+  // NOTICE 完成した領域の要素はもう辿られない
+  //        (向かい合う辺が全て塞がっているので、隣に置かれることもない)
+  void compact(int root) noexcept
+  {
+    int node = root;
+    do
+    {
+      auto slot = node / 4;
+      if (--live_[slot] == 0)
+      {
+        slot_[owner_[slot]] = -1;
+        free_slots_.push_back(slot);
+      }
+      node = next_[node];
+    }
+    while (node != root);
+  }
+
+  int find(int node) noexcept
+  {
+    int root = node;
+    while (parent_[root] != root) root = parent_[root];
+
+    // TIPS 経路圧縮
+    while (parent_[node] != root)
+    {
+      auto next = parent_[node];
+      write(parent_, PARENT, node, root);
+      node = next;
+    }
+    return root;
+  }
+
+  void unite(int a, int b) noexcept
+  {
+    a = find(a);
+    b = find(b);
+    if (a == b) return;
+
+    // 小さい方を大きい方へ繋ぐ
+    if (size_[a] < size_[b]) std::swap(a, b);
+    write(parent_, PARENT, b, a);
+    write(size_,   SIZE,   a, size_[a] + size_[b]);
+    write(open_,   OPEN,   a, open_[a] + open_[b]);
+    write(deep_,   DEEP,   a, deep_[a] + deep_[b]);
+
+    // 要素の環を繋ぐ
+    auto next = next_[a];
+    write(next_, NEXT, a, next_[b]);
+    write(next_, NEXT, b, next);
+  }
+
+  // 領域を辿る(checkAttributeEdgeと同じ順序)
+  void collect(const glm::ivec2& pos, u_int direction,
+               const Field& field, const std::vector<Panel>& panels,
+               std::vector<glm::ivec2>& comp) noexcept
+  {
+    auto slot = slot_[field.getPanelIndex(pos)];
+    const auto& status = field.getPanelStatus(pos);
+    const auto& edge   = panels[status.number].getRotatedEdge(status.rotation);
+
+    u_int dir = (direction + 2) % 4;
+
+    // 端に到達
+    if (edge[dir] & Panel::EDGE)
+    {
+      int node = slot * 4 + dir;
+      if (visited_[node] == stamp_) return;
+
+      visited_[node] = stamp_;
+      comp.push_back(pos);
+      return;
+    }
+
+    // NOTICE 端の無いパネルは先頭の要素で調査済みを判定
+    if (visited_[slot * 4] == stamp_) return;
+    visited_[slot * 4] = stamp_;
+
+    for (u_int i = 0; i < 4; ++i)
+    {
+      if (i == dir) continue;
+      if (!(edge[i] & attribute_)) continue;
+
+      collect(pos + offsets()[i], i, field, panels, comp);
+    }
+    comp.push_back(pos);
+  }
+
+
+  u_int attribute_;
+
+  // パネルの置いた順番→枠(属性が無いか畳んだら-1)
+  //   要素は (枠 * 4 + 辺の向き)
+  std::vector<int> slot_;
+  // 枠ごとのパネルの置いた順番と、完成していない要素の数
+  std::vector<int> owner_;
+  std::vector<int> live_;
+  std::vector<int> free_slots_;
+
+  // 親(辺に属性が無ければ-1)
+  std::vector<int> parent_;
+  // 以下は根の要素のみ有効
+  std::vector<int> size_;
+  // 閉じていない辺の数
+  std::vector<int> open_;
+  // 深い森の数
+  std::vector<u_int> deep_;
+  // 同じ領域の次の要素(環になっている)
+  std::vector<int> next_;
+
+  // 領域を辿る時の調査済み
+  //   stamp_と同じ値なら調査済み
+  std::vector<u_int> visited_;
+  u_int stamp_ = 0;
+
+  std::vector<u_int> completed_deep_;
+
+  // 書き換えの記録
+  struct JournalEntry
+  {
+    Array array;
+    int index;
+    int value;
+  };
+
+  // 巻き戻せる間に完成した領域(畳むのを待つ)
+  struct CompletedRegion
+  {
+    int root;
+    // 完成した時点の記録の数
+    size_t journal;
+  };
+
+  struct Journal
+  {
+    bool enabled = false;
+    std::vector<JournalEntry> entries;
+    std::vector<CompletedRegion> completed;
+  };
+  NotCopied<Journal> journal_;
+};
+
+}
@@ -7,6 +7,7 @@
 #if defined (DEBUG)
 
 #include "Defines.hpp"
+#include "Game.hpp"
 
 
 namespace ngs {
@@ -24,41 +25,22 @@ public:
       return;
     }
 
-    ci::JsonTree json;
-#if defined(OBFUSCATION_GAME_RECORD)
-    auto text = TextCodec::load(full_path.string());
-    try
-    {
-      json = ci::JsonTree(text);
-    }
-    catch (ci::JsonTree::ExcJsonParserError&)
-    {
-      DOUT << "Game record broken." << std::endl;
-      return;
-    }
-#else
-    try
-    {
-      json = ci::JsonTree(ci::loadFile(full_path));
-    }
-    catch (ci::JsonTree::ExcJsonParserError&)
+    // NOTICE JSONで保存していた頃の記録も読む
+    GameRecord record;
+    bool legacy;
+    if (!Game::readRecord(full_path, createPanels().size(), record, legacy))
     {
       DOUT << "Game record broken." << std::endl;
       return;
     }
-#endif
 
-    const auto& field = json["field"];
-    for (const auto& obj : field)
+    // 置いた順に置き直す
+    for (const auto& p : record.panels)
     {
-      auto number   = obj.getValueForKey<int>("number");
-      auto pos      = Json::getVec<glm::ivec2>(obj["pos"]);
-      auto rotation = obj.getValueForKey<u_int>("rotation");
-
       Arguments args{
-        { "panel", number },
-        { "pos",   pos },
-        { "rotation", rotation },
+        { "panel", p.number },
+        { "pos",   p.position },
+        { "rotation", p.rotation },
       };
 
       event.signal("Test:PutPanel", args);
@@ -26,7 +26,7 @@ ci::gl::GlslProgRef createShader(const std::string& vertex_path,
 // テキストファイル -> std::string
 std::string readFile(const std::string& path) noexcept
 {
-  return ci::loadString(Asset::load(path));
+  return Asset::loadString(path);
 }
 
 
@@ -0,0 +1,862 @@
+﻿#pragma once
+
+//
+// ゲームのルール部分
+//   Cinderに依存しないのでアプリ外でも動かせる
+//   Gameはこれに時間経過やイベント送信を加えたもの
+//   取り消しを有効にすると、putHandPanelで置いたパネルを１手ずつ戻せる
+//
+
+#include <vector>
+#include <array>
+#include <algorithm>
+#include <random>
+#include <numeric>
+#include <cmath>
+#include <memory>
+#include "Logic.hpp"
+#include "PanelType.hpp"
+#include "Region.hpp"
+
+
+namespace ngs {
+
+// 得点計算用パラメーター
+struct Rule
+{
+  // 道と森の計算用
+  glm::vec2 panel_rate;
+  std::vector<float> score_rates;
+  // ランク計算用
+  glm::vec3 ranking_rate;
+  // 全て置けた時の倍率
+  float perfect_score_rate;
+};
+
+
+// パネルを置いて完成したもの
+struct Completed
+{
+  std::vector<std::vector<glm::ivec2>> forests;
+  // 森ごとの深い森の数
+  std::vector<u_int> deep_forests;
+  std::vector<std::vector<glm::ivec2>> paths;
+  std::vector<glm::ivec2> churches;
+
+  bool empty() const noexcept
+  {
+    return forests.empty() && paths.empty() && churches.empty();
+  }
+};
+
+
+// 呼び出し回数を数える乱数
+// TIPS 取り消しで乱数を戻す時に、状態を丸ごと複製せず呼び出し回数で戻せる
+struct CountedEngine
+{
+  using result_type = std::mt19937::result_type;
+
+  explicit CountedEngine(uint32_t seed) noexcept
+    : engine(seed)
+  {
+  }
+
+  static constexpr result_type min() noexcept
+  {
+    return std::mt19937::min();
+  }
+
+  static constexpr result_type max() noexcept
+  {
+    return std::mt19937::max();
+  }
+
+  result_type operator()() noexcept
+  {
+    count += 1;
+    return engine();
+  }
+
+  void seed(uint32_t seed) noexcept
+  {
+    engine.seed(seed);
+    count = 0;
+  }
+
+
+  std::mt19937 engine;
+  uint64_t count = 0;
+};
+
+
+struct Simulator
+{
+  Simulator(const Rule& rule, const std::vector<Panel>& panels, uint32_t seed) noexcept
+    : rule_(rule),
+      panels_(panels),
+      types_(std::make_shared<const PanelTypes>(panels)),
+      engine_(seed),
+      position_engine_(~seed),
+      scores_(SCORE_NUM, 0)
+  {
+  }
+
+  ~Simulator() = default;
+
+
+  // 乱数の種を変更
+  // NOTICE preparationPanelの前に呼ぶ
+  void setSeed(uint32_t seed) noexcept
+  {
+    engine_.seed(seed);
+    position_engine_.seed(~seed);
+  }
+
+
+  // パネルを通し番号で用意してシャッフル
+  void preparationPanel() noexcept
+  {
+    waiting_panels.resize(panels_.size());
+    std::iota(std::begin(waiting_panels), std::end(waiting_panels), 0);
+
+    // 開始パネルを探す
+    std::vector<int> start_panels;
+    for (size_t i = 0; i < panels_.size(); ++i)
+    {
+      if (panels_[i].getAttribute() & Panel::START)
+      {
+        start_panels.push_back(int(i));
+      }
+    }
+    assert(!start_panels.empty());
+
+    if (start_panels.size() > 1)
+    {
+      // 開始パネルが何枚かある時はシャッフル
+      std::shuffle(std::begin(start_panels), std::end(start_panels), engine_);
+    }
+    start_panel_ = start_panels[0];
+
+    {
+      // 最初に置くパネルを取り除いてからシャッフル
+      auto it = std::find(std::begin(waiting_panels), std::end(waiting_panels), start_panel_);
+      assert(it != std::end(waiting_panels));
+      waiting_panels.erase(it);
+
+      std::shuffle(std::begin(waiting_panels), std::end(waiting_panels), engine_);
+    }
+  }
+
+  // 順番が決まったパネルを用意(先頭は開始パネル)
+  // NOTICE Perfectにはならない
+  void preparationPanel(const std::vector<int>& panels) noexcept
+  {
+    waiting_panels = panels;
+    start_panel_   = waiting_panels[0];
+    waiting_panels.erase(std::begin(waiting_panels));
+
+    is_tutorial_ = true;
+  }
+
+  // 開始パネル以外を全てシャッフルして待ちパネルの後ろに加える
+  void dealPanels() noexcept
+  {
+    std::vector<int> panels;
+    for (int i = 0; i < int(panels_.size()); ++i)
+    {
+      if (!(panels_[i].getAttribute() & Panel::START)) panels.push_back(i);
+    }
+    std::shuffle(std::begin(panels), std::end(panels), engine_);
+
+    appendContainer(panels, waiting_panels);
+  }
+
+  // パネル枚数を強制的に変更
+  void resizePanels(size_t num) noexcept
+  {
+    waiting_panels.resize(num);
+  }
+
+  // 最初のパネルを中央に置く
+  // 置いた時の回転を返す
+  u_int putFirstPanel() noexcept
+  {
+    auto rotation = std::uniform_int_distribution<u_int>(0, 3)(engine_);
+    putPanel(start_panel_, { 0, 0 }, rotation);
+    return rotation;
+  }
+
+  int getStartPanel() const noexcept
+  {
+    return start_panel_;
+  }
+
+  // 次のパネルを決める
+  // 置ける場所が無ければfalse
+  bool getNextPanel() noexcept
+  {
+    if (is_endless_ && waiting_panels.empty()) dealPanels();
+    if (waiting_panels.empty()) return false;
+
+    // 先頭から順に置けるかどうか調べる
+    auto index = findNextPanel(waiting_panels, panels_, *types_, field_);
+    if (index < 0)
+    {
+      // 全く置けない(積んだ)
+      // NOTICE 無限モードは新しい山を足してもう一度だけ調べる
+      if (!is_endless_ || (waiting_panels.size() >= panels_.size())) return false;
+
+      dealPanels();
+      return getNextPanel();
+    }
+
+    if (index > 0) skipped_panels += 1;
+
+    hand_panel    = waiting_panels[index];
+    hand_rotation = std::uniform_int_distribution<u_int>(0, 3)(engine_);
+
+    // コンテナから削除
+    waiting_panels.erase(std::begin(waiting_panels) + index);
+
+    // 直前に置いたパネルの取り消しで待ちパネルに戻す
+    auto* record = getLastUndoRecord();
+    if (record && record->drawn_index < 0)
+    {
+      record->drawn_index = index;
+    }
+
+    return true;
+  }
+
+  // 手持ちパネルの回転
+  void rotationHandPanel() noexcept
+  {
+    hand_rotation = (hand_rotation + 1) % 4;
+  }
+
+  // 手持ちパネルを置ける場所と回転の一覧
+  std::vector<std::pair<glm::ivec2, u_int>> searchHandPanelPlaces() const noexcept
+  {
+    std::vector<std::pair<glm::ivec2, u_int>> places;
+
+    const auto& positions = field_.getBlankPositions();
+    auto putable = searchPutablePlaces({ hand_panel }, panels_, field_);
+    const auto& rotations = putable[0];
+    for (size_t i = 0; i < positions.size(); ++i)
+    {
+      for (u_int r = 0; r < 4; ++r)
+      {
+        if (rotations[i] & (1 << r)) places.emplace_back(positions[i], r);
+      }
+    }
+
+    return places;
+  }
+
+  // 手持ちパネルが置けるか
+  bool canPutHandPanel(const glm::ivec2& pos, u_int rotation) const noexcept
+  {
+    if (!field_.isBlank(pos)) return false;
+
+    auto putable = getPutableRotation(panels_[hand_panel], field_.getBlankEdge(pos));
+    return (putable >> rotation) & 1;
+  }
+
+  // 手持ちのパネルを置く
+  // NOTICE 完成チェックはcheckCompletedで行う
+  void putHandPanel(const glm::ivec2& pos) noexcept
+  {
+    Field::Undo* field_undo = nullptr;
+    if (undo_.value.enabled)
+    {
+      field_undo = &recordUndo();
+    }
+
+    total_panels += 1;
+    putPanel(hand_panel, pos, hand_rotation, field_undo);
+  }
+
+  // パネルを追加
+  // NOTICE 取り消せるのはputHandPanelで置いたパネルだけ
+  void putPanel(int panel, const glm::ivec2& pos, u_int rotation, Field::Undo* field_undo = nullptr) noexcept
+  {
+    // Panel端をここで調べる
+    const auto& p = panels_[panel];
+    auto edge = p.getRotatedEdgeValue(rotation);
+    // NOTICE 置ける場所もFieldが更新する
+    field_.addPanel(panel, pos, rotation, edge, p.getAttribute(), field_undo);
+    forest_region_.addPanel(pos, field_, panels_);
+    path_region_.addPanel(pos, field_, panels_);
+  }
+
+
+  // 取り消しの有効・無効
+  // NOTICE 複製したSimulatorには引き継がない(無効から始まる)
+  void setUndoEnabled(bool enable) noexcept
+  {
+    auto& undo = undo_.value;
+    undo.enabled = enable;
+    undo.size    = 0;
+    // TIPS 有効なら記録は使い回す
+    if (!enable) undo.records.clear();
+    forest_region_.setJournal(enable);
+    path_region_.setJournal(enable);
+  }
+
+  bool isUndoEnabled() const noexcept
+  {
+    return undo_.value.enabled;
+  }
+
+  bool canUndo() const noexcept
+  {
+    return undo_.value.size > 0;
+  }
+
+  // 直前のputHandPanelを取り消す
+  //   その後のcheckCompletedとgetNextPanelも無かったことになり、手持ちパネルも戻る
+  // 取り除いた位置を返す
+  // NOTICE 配るパネルの乱数も戻るので、同じように置き直せば同じパネルが配られる
+  glm::ivec2 undo() noexcept
+  {
+    auto& undo = undo_.value;
+    assert(undo.size > 0);
+    const auto& record = undo.records[undo.size - 1];
+
+    if (record.drawn_index >= 0)
+    {
+      waiting_panels.insert(std::begin(waiting_panels) + record.drawn_index, hand_panel);
+    }
+    // NOTICE 無限モードで配り足した分もここで取り除く
+    waiting_panels.resize(record.waiting_size);
+    hand_panel    = record.hand_panel;
+    hand_rotation = record.hand_rotation;
+    if (engine_.count != record.engine_count)
+    {
+      // 一番古い記録の時点から進め直す
+      engine_.engine = undo.engine;
+      engine_.engine.discard(record.engine_count - undo.engine_count);
+      engine_.count  = record.engine_count;
+    }
+
+    completed_forests.resize(record.completed_forests);
+    deep_forest.resize(record.completed_forests);
+    completed_path.resize(record.completed_path);
+    completed_church.resize(record.completed_church);
+
+    for (size_t i = 0; i < SCORE_NUM; ++i)
+    {
+      scores_[i] -= record.scores[i];
+    }
+    path_score_   = record.path_score;
+    forest_score_ = record.forest_score;
+    for (auto index : record.town_counted)
+    {
+      town_counted_[index] = 0;
+    }
+
+    total_panels   = record.total_panels;
+    skipped_panels = record.skipped_panels;
+    max_path       = record.max_path;
+    max_forest     = record.max_forest;
+
+    forest_region_.rollback(record.forest_journal);
+    path_region_.rollback(record.path_journal);
+    field_.removePanel(record.field);
+
+    auto pos = record.field.position;
+    undo.size -= 1;
+    return pos;
+  }
+
+  // 完成チェック
+  Completed checkCompleted(const glm::ivec2& pos) noexcept
+  {
+    Completed completed;
+
+    // 森
+    completed.forests      = forest_region_.isComplete(pos, field_, panels_);
+    completed.deep_forests = forest_region_.getCompletedDeepForest();
+#if defined (DEBUG)
+    // 以前の実装と結果が一致するか検証
+    assert(completed.forests == isCompleteAttribute(Panel::FOREST, pos, field_, panels_));
+    for (size_t i = 0; i < completed.forests.size(); ++i)
+    {
+      assert(completed.deep_forests[i] == countDeepForest(completed.forests[i], field_, panels_));
+    }
+#endif
+    if (!completed.forests.empty())
+    {
+      appendContainer(completed.forests, completed_forests);
+      appendContainer(completed.deep_forests, deep_forest);
+
+      // 最大森
+      auto it = std::max_element(std::begin(completed.forests), std::end(completed.forests),
+                                 [](const auto& a, const auto& b)
+                                 {
+                                   return a.size() < b.size();
+                                 });
+      max_forest = u_int(it->size());
+    }
+
+    // 道
+    completed.paths = path_region_.isComplete(pos, field_, panels_);
+#if defined (DEBUG)
+    assert(completed.paths == isCompleteAttribute(Panel::PATH, pos, field_, panels_));
+#endif
+    if (!completed.paths.empty())
+    {
+      appendContainer(completed.paths, completed_path);
+
+      // 最長道
+      auto it = std::max_element(std::begin(completed.paths), std::end(completed.paths),
+                                 [](const auto& a, const auto& b)
+                                 {
+                                   return a.size() < b.size();
+                                 });
+      max_path = u_int(it->size());
+    }
+
+    // 教会
+    completed.churches = isCompleteChurch(pos, field_, panels_);
+    appendContainer(completed.churches, completed_church);
+
+    // スコア更新
+    if (!completed.empty())
+    {
+      addScores(completed);
+#if defined (DEBUG)
+      // 全て数え直した結果と一致するか検証
+      assert(scores_[1] == countTotalAttribute(completed_path, field_, panels_));
+      assert(scores_[3] == countTotalAttribute(completed_forests, field_, panels_));
+      assert(scores_[5] == countTown(completed_path, field_, panels_));
+#endif
+    }
+
+    return completed;
+  }
+
+  // 記録からFieldを復元
+  // NOTICE 取り消しの記録は消える
+  void restoreField(const Field& field) noexcept
+  {
+    field_         = field;
+    forest_region_ = Region(Panel::FOREST);
+    path_region_   = Region(Panel::PATH);
+    for (const auto& status : field_.enumeratePanels())
+    {
+      forest_region_.addPanel(status.position, field_, panels_);
+      path_region_.addPanel(status.position, field_, panels_);
+    }
+    setUndoEnabled(undo_.value.enabled);
+  }
+
+  const Field& getField() const noexcept
+  {
+    return field_;
+  }
+
+  const std::vector<Panel>& getPanels() const noexcept
+  {
+    return panels_;
+  }
+
+  const PanelTypes& getPanelTypes() const noexcept
+  {
+    return *types_;
+  }
+
+  const std::vector<u_int>& getScores() const noexcept
+  {
+    return scores_;
+  }
+
+  // 全パネルを置けた
+  bool isPerfect() const noexcept
+  {
+    return waiting_panels.empty() && !is_tutorial_ && !is_endless_;
+  }
+
+  bool isTutorial() const noexcept
+  {
+    return is_tutorial_;
+  }
+
+  void setTutorial(bool tutorial) noexcept
+  {
+    is_tutorial_ = tutorial;
+  }
+
+  // 無限モード(待ちパネルが無くなったら配り直す)
+  bool isEndless() const noexcept
+  {
+    return is_endless_;
+  }
+
+  void setEndless(bool endless) noexcept
+  {
+    is_endless_ = endless;
+  }
+
+
+  // パネルを置く場所を適当に決める
+  // 置いた場所から一番距離の近い場所を選ぶ
+  // NOTICE 配るパネルの乱数とは別にして、呼び出し回数で再現性が崩れないようにする
+  glm::ivec2 getNextPanelPosition(const glm::ivec2& put_pos) noexcept
+  {
+    glm::ivec2 pos = put_pos;
+    field_.searchNearestBlank(put_pos, position_engine_, pos);
+    return pos;
+  }
+
+
+  // スコアを全て数え直す
+  // NOTICE 完成したものを直接書き換えた時に使う
+  void updateScores() noexcept
+  {
+    std::fill(std::begin(scores_), std::end(scores_), 0);
+    path_score_   = 0;
+    forest_score_ = 0;
+    town_counted_.clear();
+
+    for (const auto& path : completed_path)
+    {
+      addPathScore(path);
+    }
+    for (size_t i = 0; i < completed_forests.size(); ++i)
+    {
+      addForestScore(completed_forests[i], deep_forest[i]);
+    }
+    scores_[6] = u_int(completed_church.size());
+  }
+
+  // 最終スコア
+  u_int calcTotalScore() const noexcept
+  {
+    const auto& score_rates = rule_.score_rates;
+
+    float score = 0;
+
+    // 道と森はaddScoresで加算済み
+    score += path_score_;
+    score += forest_score_;
+
+    // 街の数
+    score += scores_[5] * score_rates[3];
+    // 教会
+    score += scores_[6] * score_rates[4];
+    // パネル設置数
+    score += total_panels * score_rates[5];
+
+    // Perfect
+    if (isPerfect())
+    {
+      score *= rule_.perfect_score_rate;
+    }
+
+    return score;
+  }
+
+  // ランキングを決める
+  u_int calcRanking(int score) const noexcept
+  {
+    const auto& rate = rule_.ranking_rate;
+    u_int rank;
+    // FIXME Magic Number
+    for (rank = 0; rank < 9; ++rank)
+    {
+      // ランク後半ほど高得点が必要になる
+      int s = std::pow(rate.x, rank * rate.y) * rate.z;
+      if (score < s) break;
+    }
+
+    return rank;
+  }
+
+
+  // 配置するパネル
+  std::vector<int> waiting_panels;
+  // 手持ちのパネル
+  int hand_panel = 0;
+  u_int hand_rotation = 0;
+
+  // 完成した森
+  std::vector<std::vector<glm::ivec2>> completed_forests;
+  // 深い森
+  std::vector<u_int> deep_forest;
+  // 完成した道
+  std::vector<std::vector<glm::ivec2>> completed_path;
+  // 完成した教会
+  std::vector<glm::ivec2> completed_church;
+
+  // 最初のパネルを除いた設置数
+  u_int total_panels = 0;
+  // 先頭の待ちパネルが置けず、後ろのパネルを配った回数
+  u_int skipped_panels = 0;
+
+  // 最長道
+  u_int max_path = 0;
+  // 最大森
+  u_int max_forest = 0;
+
+
+private:
+  enum {
+    // スコアの種類
+    SCORE_NUM = 7,
+    // 取り消せる手数
+    UNDO_MAX  = 256,
+  };
+
+  struct UndoRecord;
+
+
+  // 完成したものの分だけスコアを加算
+  void addScores(const Completed& completed) noexcept
+  {
+    std::array<u_int, SCORE_NUM> before;
+    std::copy(std::begin(scores_), std::end(scores_), std::begin(before));
+
+    for (const auto& path : completed.paths)
+    {
+      addPathScore(path);
+    }
+    for (size_t i = 0; i < completed.forests.size(); ++i)
+    {
+      addForestScore(completed.forests[i], completed.deep_forests[i]);
+    }
+    scores_[6] += u_int(completed.churches.size());
+
+    // 取り消し用に増えた分を記録
+    if (auto* record = getLastUndoRecord())
+    {
+      for (size_t i = 0; i < SCORE_NUM; ++i)
+      {
+        record->scores[i] += scores_[i] - before[i];
+      }
+    }
+  }
+
+  void addPathScore(const std::vector<glm::ivec2>& path) noexcept
+  {
+    // FIXME MagicNumber
+    scores_[0] += 1;
+    scores_[1] += countArea(path);
+    for (const auto& p : path)
+    {
+      // TIPS 同じ場所にある街は再カウントしない
+      if (!(panels_[field_.getPanelStatus(p).number].getAttribute() & Panel::BUILDING)) continue;
+      if (markPanel(town_counted_, p))
+      {
+        scores_[5] += 1;
+        if (auto* record = getLastUndoRecord())
+        {
+          record->town_counted.push_back(field_.getPanelIndex(p));
+        }
+      }
+    }
+
+    // TIPS 長い道ほど指数関数的に得点が上がる
+    const auto& panel_rate = rule_.panel_rate;
+    path_score_ += std::pow(float(path.size()), panel_rate.x) * panel_rate.y * rule_.score_rates[0];
+  }
+
+  void addForestScore(const std::vector<glm::ivec2>& forest, u_int deep) noexcept
+  {
+    scores_[2] += 1;
+    scores_[3] += countArea(forest);
+    if (deep > 0) scores_[4] += 1;
+
+    // TIPS 面積が大きいほど指数関数的に得点が上がる
+    const auto& panel_rate = rule_.panel_rate;
+    auto count = forest.size() + deep * rule_.score_rates[2];
+    forest_score_ += std::pow(float(count), panel_rate.x) * panel_rate.y * rule_.score_rates[1];
+  }
+
+  // 面積(countTotalAttributeと同じく、同じ場所は１つの森(道)の中でだけ再カウントしない)
+  u_int countArea(const std::vector<glm::ivec2>& area) noexcept
+  {
+    u_int count = 0;
+    for (const auto& p : area)
+    {
+      if (markPanel(area_counted_, p)) count += 1;
+    }
+    // 次に使うために戻しておく
+    for (const auto& p : area)
+    {
+      area_counted_[field_.getPanelIndex(p)] = 0;
+    }
+    return count;
+  }
+
+  // 置く前の状態を記録
+  // TIPS 記録は使い回し、数が上限に達したら古い方から半分捨てる
+  Field::Undo& recordUndo() noexcept
+  {
+    auto& undo = undo_.value;
+    if (undo.size == 0)
+    {
+      // TIPS 戻せる手が無い時の書き換えは要らない
+      forest_region_.setJournal(true);
+      path_region_.setJournal(true);
+
+      undo.engine       = engine_.engine;
+      undo.engine_count = engine_.count;
+    }
+    else if (undo.size == UNDO_MAX)
+    {
+      dropOldUndo(UNDO_MAX / 2);
+    }
+
+    if (undo.size == undo.records.size()) undo.records.emplace_back();
+    auto& record = undo.records[undo.size];
+    undo.size += 1;
+
+    record.forest_journal = forest_region_.getJournalSize();
+    record.path_journal   = path_region_.getJournalSize();
+
+    record.hand_panel    = hand_panel;
+    record.hand_rotation = hand_rotation;
+    record.engine_count  = engine_.count;
+    record.waiting_size  = waiting_panels.size();
+    record.drawn_index   = -1;
+
+    record.completed_forests = completed_forests.size();
+    record.completed_path    = completed_path.size();
+    record.completed_church  = completed_church.size();
+
+    record.scores.fill(0);
+    record.path_score   = path_score_;
+    record.forest_score = forest_score_;
+    record.town_counted.clear();
+
+    record.total_panels   = total_panels;
+    record.skipped_panels = skipped_panels;
+    record.max_path       = max_path;
+    record.max_forest     = max_forest;
+
+    return record.field;
+  }
+
+  // 古い記録をnum個捨てる
+  void dropOldUndo(size_t num) noexcept
+  {
+    auto& undo    = undo_.value;
+    auto& records = undo.records;
+    assert(num < undo.size);
+
+    // 残る一番古い記録の時点まで進める
+    const auto& oldest = records[num];
+    undo.engine.discard(oldest.engine_count - undo.engine_count);
+    undo.engine_count = oldest.engine_count;
+
+    auto forest_journal = oldest.forest_journal;
+    auto path_journal   = oldest.path_journal;
+    forest_region_.dropJournal(forest_journal);
+    path_region_.dropJournal(path_journal);
+
+    // TIPS 捨てた記録は後ろへ回して使い回す
+    std::rotate(std::begin(records), std::begin(records) + num, std::begin(records) + undo.size);
+    undo.size -= num;
+    for (size_t i = 0; i < undo.size; ++i)
+    {
+      records[i].forest_journal -= forest_journal;
+      records[i].path_journal   -= path_journal;
+    }
+  }
+
+  UndoRecord* getLastUndoRecord() noexcept
+  {
+    auto& undo = undo_.value;
+    return (undo.enabled && undo.size > 0) ? &undo.records[undo.size - 1] : nullptr;
+  }
+
+  // 初めての場所ならtrue
+  bool markPanel(std::vector<char>& counted, const glm::ivec2& pos) noexcept
+  {
+    size_t index = field_.getPanelIndex(pos);
+    if (index >= counted.size()) counted.resize(field_.enumeratePanels().size(), 0);
+    if (counted[index]) return false;
+
+    counted[index] = 1;
+    return true;
+  }
+
+
+  Rule rule_;
+  const std::vector<Panel>& panels_;
+  // NOTICE 複製したSimulatorで共有する
+  std::shared_ptr<const PanelTypes> types_;
+
+  CountedEngine engine_;
+  // 置く場所を決める用
+  std::mt19937 position_engine_;
+
+  bool is_tutorial_ = false;
+  bool is_endless_  = false;
+
+  // 最初に中央に配置するパネル
+  int start_panel_ = 0;
+
+  Field field_;
+  // 森と道の繋がり
+  Region forest_region_ { Panel::FOREST };
+  Region path_region_   { Panel::PATH };
+
+  // スコア
+  std::vector<u_int> scores_;
+  // 完成した道と森の得点
+  float path_score_   = 0;
+  float forest_score_ = 0;
+  // 数えた場所(Fieldに置いた順番が添字)
+  std::vector<char> area_counted_;
+  std::vector<char> town_counted_;
+
+  // １手戻すための記録
+  // TIPS 盤面は複製せず、変わった所だけを持つ
+  struct UndoRecord
+  {
+    Field::Undo field;
+    size_t forest_journal;
+    size_t path_journal;
+
+    int hand_panel;
+    u_int hand_rotation;
+    // 乱数の呼び出し回数
+    uint64_t engine_count;
+    size_t waiting_size;
+    // 置いた後に手持ちにした待ちパネルの位置(-1なら配っていない)
+    int drawn_index = -1;
+
+    size_t completed_forests;
+    size_t completed_path;
+    size_t completed_church;
+
+    // 増えたスコア
+    std::array<u_int, SCORE_NUM> scores;
+    float path_score;
+    float forest_score;
+    // 新しく数えた街(Fieldに置いた順番)
+    std::vector<int> town_counted;
+
+    u_int total_panels;
+    u_int skipped_panels;
+    u_int max_path;
+    u_int max_forest;
+  };
+
+  struct Undo
+  {
+    bool enabled = false;
+    // NOTICE sizeより後ろは使い回すための空き
+    std::vector<UndoRecord> records;
+    size_t size = 0;
+
+    // 一番古い記録の時点の乱数
+    std::mt19937 engine;
+    uint64_t engine_count = 0;
+  };
+  NotCopied<Undo> undo_;
+};
+
+}
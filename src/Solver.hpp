@@ -0,0 +1,363 @@
+﻿#pragma once
+
+//
+// 配られたパネルを全て置けるか調べる
+//   ゲームと同じく、待ちパネルの先頭から置けるものを順に手持ちにする
+//   深さ優先で(置き場所, 回転)を試し、置き切れなかった局面を置換表に覚える
+//
+//   局面のハッシュは升目ごとの端情報と、残りのパネルの種類の並びから作る
+//   端情報が同じパネルは区別しないので、同じ形のパネル違いの局面は１つにまとまる
+//   盤面は複製せず、置いたパネルを取り除いて次の手を試す
+//
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <memory>
+#include <algorithm>
+#include "Logic.hpp"
+#include "PanelType.hpp"
+
+
+namespace ngs {
+
+class Solver
+{
+public:
+  // 置いた手順
+  struct Step
+  {
+    int panel;
+    glm::ivec2 position;
+    u_int rotation;
+  };
+
+  struct Result
+  {
+    // 全て置ける手順が見つかった
+    bool solved = false;
+    // 最後まで調べた(falseなら探索数の上限で打ち切り)
+    bool exhausted = false;
+    // 最初のパネルを含む手順
+    std::vector<Step> witness;
+    uint64_t nodes = 0;
+  };
+
+
+  // table_bytes: 置換表に使うメモリ量
+  Solver(const std::vector<Panel>& panels, size_t table_bytes, u_int threads) noexcept
+    : panels_(panels),
+      threads_(std::max(threads, 1u)),
+      types_(panels)
+  {
+    // TIPS 置換表は２の冪にして添字をマスクで求める
+    size_t entries = 1;
+    while (entries * 2 * sizeof(uint64_t) <= table_bytes) entries *= 2;
+    table_.reset(new std::atomic<uint64_t>[entries]);
+    table_mask_ = entries - 1;
+  }
+
+  ~Solver() = default;
+
+
+  // start_panelを回転start_rotationで中央に置いた状態から調べる
+  // max_nodes: 探索する局面数の上限(0で無制限)
+  Result solve(int start_panel, u_int start_rotation, const std::vector<int>& waiting_panels,
+               uint64_t max_nodes = 0) noexcept
+  {
+    clearTable();
+
+    Result result;
+
+    Field field;
+    const auto& start = panels_[start_panel];
+    field.addPanel(start_panel, { 0, 0 }, start_rotation, start.getRotatedEdgeValue(start_rotation), start.getAttribute());
+    Step first { start_panel, { 0, 0 }, start_rotation };
+
+    // 最初の２手までを仕事に分けて、スレッドで取り合う
+    std::vector<std::vector<Step>> tasks;
+    {
+      for (const auto& step : expand(field, waiting_panels))
+      {
+        Field f      = field;
+        auto waiting = waiting_panels;
+        apply(f, waiting, step);
+
+        auto next = expand(f, waiting);
+        if (next.empty())
+        {
+          tasks.push_back({ step });
+        }
+        for (const auto& s : next)
+        {
+          tasks.push_back({ step, s });
+        }
+      }
+      if (tasks.empty())
+      {
+        // 最初の１枚も置けない
+        result.solved    = waiting_panels.empty();
+        result.exhausted = true;
+        if (result.solved) result.witness.push_back(first);
+        return result;
+      }
+    }
+
+    std::atomic<size_t> next_task(0);
+    std::atomic<bool> solved(false);
+    std::atomic<bool> aborted(false);
+    std::atomic<uint64_t> nodes(0);
+    std::mutex mutex;
+
+    auto worker = [&]()
+                  {
+                    Context ctx { solved, aborted, nodes, max_nodes, 0 };
+                    while (!solved && !aborted)
+                    {
+                      auto index = next_task.fetch_add(1);
+                      if (index >= tasks.size()) break;
+
+                      Field f = field;
+                      auto waiting = waiting_panels;
+                      std::vector<Step> path { first };
+                      for (const auto& step : tasks[index])
+                      {
+                        apply(f, waiting, step);
+                        path.push_back(step);
+                      }
+
+                      if (search(f, waiting, fieldHash(f), path, ctx))
+                      {
+                        std::lock_guard<std::mutex> lock(mutex);
+                        if (!solved)
+                        {
+                          solved = true;
+                          result.witness = path;
+                        }
+                      }
+                    }
+                    nodes += ctx.local_nodes;
+                  };
+
+    std::vector<std::thread> workers;
+    for (u_int i = 1; i < threads_; ++i)
+    {
+      workers.emplace_back(worker);
+    }
+    worker();
+    for (auto& w : workers)
+    {
+      w.join();
+    }
+
+    result.solved    = solved;
+    result.exhausted = solved || !aborted;
+    result.nodes     = nodes;
+    return result;
+  }
+
+
+private:
+  struct Context
+  {
+    std::atomic<bool>& solved;
+    std::atomic<bool>& aborted;
+    std::atomic<uint64_t>& nodes;
+    uint64_t max_nodes;
+
+    // TIPS 共有カウンタへの加算はまとめて行う
+    uint64_t local_nodes;
+
+    bool stop() noexcept
+    {
+      if ((++local_nodes & 1023) == 0)
+      {
+        auto n = nodes.fetch_add(1024) + 1024;
+        local_nodes = 0;
+        if (max_nodes && n >= max_nodes) aborted = true;
+      }
+      return solved || aborted;
+    }
+  };
+
+
+  // 置ける判定に使う端の情報だけを残す
+  static uint64_t maskEdge(uint64_t edge) noexcept
+  {
+    uint64_t mask = Panel::EDGE_MASK;
+    return edge & (mask | (mask << 16) | (mask << 32) | (mask << 48));
+  }
+
+  static uint64_t mix(uint64_t v) noexcept
+  {
+    // SOURCE: splitmix64
+    v += 0x9e3779b97f4a7c15;
+    v = (v ^ (v >> 30)) * 0xbf58476d1ce4e5b9;
+    v = (v ^ (v >> 27)) * 0x94d049bb133111eb;
+    return v ^ (v >> 31);
+  }
+
+  // 升目と端情報ごとの乱数(Zobrist hashing)
+  static uint64_t cellKey(const glm::ivec2& pos, uint64_t edge) noexcept
+  {
+    uint64_t p = (uint64_t(uint32_t(pos.x)) << 32) | uint32_t(pos.y);
+    return mix(mix(p) ^ maskEdge(edge));
+  }
+
+  static uint64_t fieldHash(const Field& field) noexcept
+  {
+    uint64_t hash = 0;
+    for (const auto& status : field.enumeratePanels())
+    {
+      hash ^= cellKey(status.position, status.edge);
+    }
+    return hash;
+  }
+
+  uint64_t waitingHash(const std::vector<int>& waiting) const noexcept
+  {
+    uint64_t hash = waiting.size();
+    for (auto panel : waiting)
+    {
+      hash = mix(hash + types_.getShape(panel));
+    }
+    return hash;
+  }
+
+
+  void clearTable() noexcept
+  {
+    for (size_t i = 0; i <= table_mask_; ++i)
+    {
+      table_[i].store(0, std::memory_order_relaxed);
+    }
+  }
+
+  bool findTable(uint64_t key) const noexcept
+  {
+    return table_[key & table_mask_].load(std::memory_order_relaxed) == key;
+  }
+
+  void storeTable(uint64_t key) noexcept
+  {
+    // NOTICE 衝突したら上書き
+    table_[key & table_mask_].store(key, std::memory_order_relaxed);
+  }
+
+
+  // 次の手持ちパネル(ゲームと同じ規則)
+  int nextPanel(const Field& field, const std::vector<int>& waiting) const noexcept
+  {
+    return findNextPanel(waiting, panels_, types_, field);
+  }
+
+  // 手持ちパネルの置き方を列挙
+  std::vector<Step> expand(const Field& field, const std::vector<int>& waiting) const noexcept
+  {
+    std::vector<Step> steps;
+
+    auto index = nextPanel(field, waiting);
+    if (index < 0) return steps;
+
+    int panel = waiting[index];
+    const auto& p         = panels_[panel];
+    const auto& positions = field.getBlankPositions();
+    const auto& edges     = field.getBlankEdges();
+    for (size_t i = 0; i < positions.size(); ++i)
+    {
+      auto rotation = getPutableRotation(p, edges[i]);
+      for (u_int r = 0; r < 4; ++r)
+      {
+        if (!(rotation & (1 << r))) continue;
+
+        // 回転対称なパネルは同じ形になる回転を１つにまとめる
+        bool same = false;
+        for (u_int k = 0; k < r; ++k)
+        {
+          if ((rotation & (1 << k)) && maskEdge(p.getRotatedEdgeValue(k)) == maskEdge(p.getRotatedEdgeValue(r))) same = true;
+        }
+        if (!same) steps.push_back({ panel, positions[i], r });
+      }
+    }
+
+    // 周りが埋まっている場所から試す
+    std::stable_sort(std::begin(steps), std::end(steps),
+                     [&field](const Step& a, const Step& b)
+                     {
+                       return countAround(field, a.position) > countAround(field, b.position);
+                     });
+
+    return steps;
+  }
+
+  static int countAround(const Field& field, const glm::ivec2& pos) noexcept
+  {
+    return int(field.existsPanel(pos + glm::ivec2(0, 1)))
+         + int(field.existsPanel(pos + glm::ivec2(1, 0)))
+         + int(field.existsPanel(pos + glm::ivec2(0, -1)))
+         + int(field.existsPanel(pos + glm::ivec2(-1, 0)));
+  }
+
+  // 置いた待ちパネルの位置を返す
+  size_t apply(Field& field, std::vector<int>& waiting, const Step& step, Field::Undo* undo = nullptr) const noexcept
+  {
+    const auto& panel = panels_[step.panel];
+    field.addPanel(step.panel, step.position, step.rotation, panel.getRotatedEdgeValue(step.rotation), panel.getAttribute(),
+                   undo);
+    auto it = std::find(std::begin(waiting), std::end(waiting), step.panel);
+    auto index = size_t(it - std::begin(waiting));
+    waiting.erase(it);
+    return index;
+  }
+
+  void restore(Field& field, std::vector<int>& waiting, const Step& step, const Field::Undo& undo, size_t index) const noexcept
+  {
+    field.removePanel(undo);
+    waiting.insert(std::begin(waiting) + index, step.panel);
+  }
+
+  // NOTICE fieldとwaitingは調べ終わったら元に戻っている
+  bool search(Field& field, std::vector<int>& waiting, uint64_t field_hash,
+              std::vector<Step>& path, Context& ctx) noexcept
+  {
+    if (waiting.empty()) return true;
+    if (ctx.stop()) return false;
+
+    auto key = field_hash ^ waitingHash(waiting);
+    // NOTICE 0は空きの印
+    if (key == 0) key = 1;
+    if (findTable(key)) return false;
+
+    for (const auto& step : expand(field, waiting))
+    {
+      Field::Undo undo;
+      auto index = apply(field, waiting, step, &undo);
+
+      path.push_back(step);
+      bool solved = search(field, waiting, field_hash ^ cellKey(step.position, panels_[step.panel].getRotatedEdgeValue(step.rotation)),
+                           path, ctx);
+      restore(field, waiting, step, undo, index);
+      if (solved) return true;
+      path.pop_back();
+
+      if (ctx.solved || ctx.aborted) return false;
+    }
+
+    // 置き切れない局面
+    storeTable(key);
+    return false;
+  }
+
+
+  const std::vector<Panel>& panels_;
+  u_int threads_;
+
+  // パネルの形で局面をまとめる
+  PanelTypes types_;
+
+  std::unique_ptr<std::atomic<uint64_t>[]> table_;
+  size_t table_mask_;
+};
+
+}
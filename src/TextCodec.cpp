@@ -2,102 +2,266 @@
 // text encode/decode
 // 
 
-#include "Defines.hpp"
-#include <iostream>
 #include <fstream>
+#include <algorithm>
 #include <cassert>
-#include <zlib.h>
-#include <cinder/app/App.h>
-#include <cinder/DataTarget.h>
 #include "TextCodec.hpp"
+#include "MappedFile.hpp"
 
 
 namespace ngs { namespace TextCodec {
 
 enum {
-  OUTBUFSIZ = 1024 * 8,
+  VERSION = 1,
+  HEADER_SIZE = 8,
+
+  // 書き出し先が足りない時に増やす大きさ(最小)
+  GROW_SIZE = 1024 * 8,
+  // ファイルから一度に読む大きさ
+  READ_SIZE = 1024 * 64,
+  // 先に確保する上限(壊れたヘッダで巨大な確保をしない)
+  MAX_RESERVE_SIZE = 1024 * 1024 * 64,
 };
 
 
-// 圧縮
-std::string encode(const std::string& input) noexcept
+static void writeUint32(std::string& output, uint32_t value) noexcept
+{
+  for (int i = 0; i < 4; ++i)
+  {
+    output.push_back(char((value >> (i * 8)) & 0xff));
+  }
+}
+
+static uint32_t readUint32(const char* data) noexcept
 {
-  z_stream z;
-  z.zalloc = Z_NULL;
-  z.zfree  = Z_NULL;
-  z.opaque = Z_NULL;
-  deflateInit(&z, Z_DEFAULT_COMPRESSION);
+  uint32_t value = 0;
+  for (int i = 0; i < 4; ++i)
+  {
+    value |= uint32_t((unsigned char)data[i]) << (i * 8);
+  }
+  return value;
+}
+
+
+Encoder::Encoder() noexcept
+{
+  z_.zalloc = Z_NULL;
+  z_.zfree  = Z_NULL;
+  z_.opaque = Z_NULL;
+  deflateInit(&z_, Z_DEFAULT_COMPRESSION);
+}
+
+Encoder::~Encoder()
+{
+  deflateEnd(&z_);
+}
+
+void Encoder::begin(std::string& output, size_t size) noexcept
+{
+  deflateReset(&z_);
+
+  output_ = &output;
+  size_   = size;
+  pushed_ = 0;
+
+  // TIPS 圧縮後の最大の大きさを先に確保しておく
+  output.clear();
+  output.reserve(HEADER_SIZE + deflateBound(&z_, uLong(size)));
+
+  output.append("PMZ");
+  output.push_back(char(VERSION));
+  writeUint32(output, uint32_t(size));
+}
+
+void Encoder::push(const char* data, size_t size) noexcept
+{
+  pushed_ += size;
 
   // SOURCE:http://yak-ex.blogspot.jp/2012/12/c-advent-calendar-2012-8-c-compiler-farm.html
-  z.next_in  = const_cast<Bytef*>(reinterpret_cast<const Bytef*>(input.c_str()));
-  z.avail_in = static_cast<unsigned int>(input.size());
+  z_.next_in  = const_cast<Bytef*>(reinterpret_cast<const Bytef*>(data));
+  z_.avail_in = uInt(size);
+  deflateTo(Z_NO_FLUSH);
+}
 
-  Bytef outbuf[OUTBUFSIZ];
-  z.next_out  = outbuf;
-  z.avail_out = OUTBUFSIZ;
+bool Encoder::finish() noexcept
+{
+  z_.next_in  = Z_NULL;
+  z_.avail_in = 0;
+  deflateTo(Z_FINISH);
 
-  std::string output;
-  while (1)
+  return pushed_ == size_;
+}
+
+// 書き出し先の空き領域へ直接圧縮する
+void Encoder::deflateTo(int flush) noexcept
+{
+  auto& output = *output_;
+  while (true)
   {
-    int status = deflate(&z, Z_FINISH);
+    auto used = output.size();
+    if (output.capacity() == used) output.reserve(used + GROW_SIZE);
+    output.resize(output.capacity());
+
+    z_.next_out  = reinterpret_cast<Bytef*>(&output[used]);
+    z_.avail_out = uInt(output.size() - used);
+
+    int status = deflate(&z_, flush);
     assert(status != Z_STREAM_ERROR);
-    
-    if ((z.avail_out == 0) || (status == Z_STREAM_END))
-    {
-      u_int count = OUTBUFSIZ - z.avail_out;
-      output.insert(output.end(), &outbuf[0], &outbuf[count]);
+    output.resize(output.size() - z_.avail_out);
 
+    if (flush == Z_FINISH)
+    {
       if (status == Z_STREAM_END) break;
-      
-      z.next_out  = outbuf;
-      z.avail_out = OUTBUFSIZ;
+    }
+    else if (z_.avail_in == 0 && z_.avail_out != 0)
+    {
+      break;
     }
   }
-  deflateEnd(&z);
+}
 
-  return output;
+
+Decoder::Decoder() noexcept
+{
+  z_.zalloc   = Z_NULL;
+  z_.zfree    = Z_NULL;
+  z_.opaque   = Z_NULL;
+  z_.next_in  = Z_NULL;
+  z_.avail_in = 0;
+  inflateInit(&z_);
 }
 
-// 伸長
-std::string decode(const std::string& input) noexcept
+Decoder::~Decoder()
 {
-  z_stream z;
-  z.zalloc = Z_NULL;
-  z.zfree  = Z_NULL;
-  z.opaque = Z_NULL;
-  inflateInit(&z);
-  
-  z.next_in  = const_cast<Bytef*>(reinterpret_cast<const Bytef*>(input.c_str()));
-  z.avail_in = static_cast<unsigned int>(input.size());
+  inflateEnd(&z_);
+}
 
-  Bytef outbuf[OUTBUFSIZ];
-  z.next_out  = outbuf;
-  z.avail_out = OUTBUFSIZ;
+void Decoder::begin(std::string& output) noexcept
+{
+  inflateReset(&z_);
 
-  std::string output;
-  while (1) {
-    int status = inflate(&z, Z_NO_FLUSH);
-    if ((status == Z_STREAM_ERROR) || (status == Z_DATA_ERROR))
+  output_ = &output;
+  output.clear();
+
+  state_  = State::HEADER;
+  legacy_ = false;
+  header_.clear();
+  size_ = 0;
+}
+
+bool Decoder::push(const char* data, size_t size) noexcept
+{
+  if (state_ == State::HEADER)
+  {
+    // NOTICE zlibの先頭は'P'にならない
+    if (header_.empty() && size > 0 && data[0] != 'P')
     {
-      // エラーが起こった場合は空の文字列を返す
-      DOUT << "decode error!!" << std::endl;
-      
-      inflateEnd(&z);
-      return std::string();
+      legacy_ = true;
+      state_  = State::BODY;
     }
-
-    if ((z.avail_out == 0) || (status == Z_STREAM_END))
+    else
     {
-      u_int count = OUTBUFSIZ - z.avail_out;
-      output.insert(output.end(), &outbuf[0], &outbuf[count]);
+      auto n = std::min(size, size_t(HEADER_SIZE) - header_.size());
+      header_.append(data, n);
+      data += n;
+      size -= n;
+      if (header_.size() < HEADER_SIZE) return true;
 
-      if (status == Z_STREAM_END) break;
+      if (header_.compare(0, 3, "PMZ") != 0 || (unsigned char)header_[3] != VERSION)
+      {
+        state_ = State::ERROR;
+        return false;
+      }
 
-      z.next_out  = outbuf;
-      z.avail_out = OUTBUFSIZ;
+      size_ = readUint32(&header_[4]);
+      output_->reserve(std::min(size_, size_t(MAX_RESERVE_SIZE)));
+      state_ = State::BODY;
     }
   }
-  inflateEnd(&z);
+
+  if (state_ == State::BODY)
+  {
+    if (!inflateFrom(data, size)) return false;
+    size = z_.avail_in;
+  }
+
+  // 圧縮データの後ろに余分なデータがある
+  if (state_ == State::END && size > 0) state_ = State::ERROR;
+
+  return state_ != State::ERROR;
+}
+
+bool Decoder::finish() noexcept
+{
+  if (state_ != State::END) return false;
+
+  return legacy_ || output_->size() == size_;
+}
+
+// 書き出し先の空き領域へ直接伸長する
+bool Decoder::inflateFrom(const char* data, size_t size) noexcept
+{
+  auto& output = *output_;
+
+  z_.next_in  = const_cast<Bytef*>(reinterpret_cast<const Bytef*>(data));
+  z_.avail_in = uInt(size);
+  while (z_.avail_in > 0)
+  {
+    auto used = output.size();
+    if (output.capacity() == used) output.reserve(std::max(used * 2, used + GROW_SIZE));
+    output.resize(output.capacity());
+
+    z_.next_out  = reinterpret_cast<Bytef*>(&output[used]);
+    z_.avail_out = uInt(output.size() - used);
+
+    int status = inflate(&z_, Z_NO_FLUSH);
+    output.resize(output.size() - z_.avail_out);
+
+    // NOTICE Adler-32はzlibが確かめている
+    if (status == Z_STREAM_END)
+    {
+      state_ = State::END;
+      break;
+    }
+    if (status != Z_OK && status != Z_BUF_ERROR)
+    {
+      // エラーが起こった
+      state_ = State::ERROR;
+      return false;
+    }
+  }
+
+  return true;
+}
+
+
+// 圧縮
+std::string encode(const std::string& input) noexcept
+{
+  static thread_local Encoder encoder;
+
+  std::string output;
+  encoder.begin(output, input.size());
+  encoder.push(input.data(), input.size());
+  encoder.finish();
+
+  return output;
+}
+
+// 伸長
+bool decode(const char* data, size_t size, std::string& output) noexcept
+{
+  static thread_local Decoder decoder;
+
+  decoder.begin(output);
+  return decoder.push(data, size) && decoder.finish();
+}
+
+// NOTICE 壊れていたら空の文字列を返す
+std::string decode(const std::string& input) noexcept
+{
+  std::string output;
+  if (!decode(input.data(), input.size(), output)) output.clear();
 
   return output;
 }
@@ -108,22 +272,41 @@ void write(const std::string& path, const std::string& input) noexcept
 {
   auto output = encode(input);
 
-  // Cinderにファイル書き出しが用意されていた
-  auto data_ref = ci::writeFile(path);
-  data_ref->getStream()->write(output);
+  std::ofstream fstr(path, std::ios::binary | std::ios::trunc);
+  fstr.write(output.data(), output.size());
 }
 
 // 読み込み
+// TIPS ファイルの内容(大きいファイルはマップする)から、元の大きさで確保した領域へ直接伸長する
 std::string load(const std::string& path) noexcept
 {
+  MappedFile file(path);
+  if (file.isValid())
+  {
+    std::string output;
+    if (!decode(file.data(), file.size(), output)) output.clear();
+    return output;
+  }
+
+  // マップできなかった時などは少しずつ読んでは伸長する
   std::ifstream fstr(path, std::ios::binary);
   assert(fstr);
 
-  // SOURCE: http://fa11enprince.hatenablog.com/entry/2014/04/03/233500
-  std::string input((std::istreambuf_iterator<char>(fstr)),
-                    std::istreambuf_iterator<char>());
-    
-  return decode(input);
+  static thread_local Decoder decoder;
+
+  std::string output;
+  decoder.begin(output);
+
+  std::string buffer(READ_SIZE, 0);
+  bool ok = true;
+  while (ok && fstr)
+  {
+    fstr.read(&buffer[0], buffer.size());
+    ok = decoder.push(buffer.data(), size_t(fstr.gcount()));
+  }
+  if (!ok || !decoder.finish()) output.clear();
+
+  return output;
 }
 
 } }
@@ -3,14 +3,99 @@
 //
 // text encode/decode
 //
+// 書式
+//   "PMZ" version(1byte) 元の長さ(4byte little endian)
+//   zlibで圧縮したデータ
+//
+// NOTICE zlibのデータの最後には元のデータのAdler-32が付いている
+//        最後まで読めて、Adler-32と長さが一致した時だけ読み込めたことにする
+//
+// NOTICE 先頭が"PMZ"でなければ、以前の書式(zlibで圧縮しただけ)として読む
+//        ツール(filedz)で作ったアセットもこちら
+//
 
 #include <string>
+#include <zlib.h>
 
 
 namespace ngs { namespace TextCodec {
 
+// 圧縮(少しずつ渡せる)
+// TIPS zlibの作業領域は使い回す
+class Encoder
+{
+public:
+  Encoder() noexcept;
+  ~Encoder();
+
+  Encoder(const Encoder&) = delete;
+  Encoder& operator=(const Encoder&) = delete;
+
+  // 書き出しを始める
+  // size: 元のデータの長さ(全部で)
+  void begin(std::string& output, size_t size) noexcept;
+  void push(const char* data, size_t size) noexcept;
+  // 渡したデータがbeginで指定した長さと違ったらfalse
+  bool finish() noexcept;
+
+
+private:
+  void deflateTo(int flush) noexcept;
+
+  z_stream z_;
+
+  std::string* output_ = nullptr;
+  size_t size_   = 0;
+  size_t pushed_ = 0;
+};
+
+// 伸長(少しずつ渡せる)
+class Decoder
+{
+public:
+  Decoder() noexcept;
+  ~Decoder();
+
+  Decoder(const Decoder&) = delete;
+  Decoder& operator=(const Decoder&) = delete;
+
+  // 読み込みを始める
+  // TIPS 元の長さが分かれば、書き出し先を先に確保する
+  void begin(std::string& output) noexcept;
+  // 壊れていたらfalse
+  bool push(const char* data, size_t size) noexcept;
+  // 最後まで読めて、長さが一致すればtrue
+  bool finish() noexcept;
+
+
+private:
+  bool inflateFrom(const char* data, size_t size) noexcept;
+
+  enum class State {
+    HEADER,
+    BODY,
+    END,
+    ERROR,
+  };
+
+  z_stream z_;
+
+  std::string* output_ = nullptr;
+  State state_ = State::HEADER;
+  // 以前の書式
+  bool legacy_ = false;
+
+  // ヘッダ(途中で分かれて届いても良いように貯める)
+  std::string header_;
+
+  size_t size_ = 0;
+};
+
+
 std::string encode(const std::string& input) noexcept;
 std::string decode(const std::string& input) noexcept;
+// 壊れていたらfalse
+bool decode(const char* data, size_t size, std::string& output) noexcept;
 
 void write(const std::string& path, const std::string& input) noexcept;
 std::string load(const std::string& path) noexcept;
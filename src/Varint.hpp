@@ -0,0 +1,53 @@
+﻿#pragma once
+
+//
+// 可変長整数の読み書き
+//   MoveLogとGameRecordで共有する
+//   7bitずつ下位から並べ、続きがあれば最上位bitを立てる
+//
+
+#include <string>
+#include <cstdint>
+#include "Defines.hpp"
+
+
+namespace ngs { namespace Varint {
+
+// 符号付き整数を小さい正の整数に並べ替える(0, -1, 1, -2...)
+inline uint32_t zigzag(int v) noexcept
+{
+  return (uint32_t(v) << 1) ^ uint32_t(v >> 31);
+}
+
+inline int unzigzag(uint32_t v) noexcept
+{
+  return int(v >> 1) ^ -int(v & 1);
+}
+
+inline void write(std::string& data, uint32_t v) noexcept
+{
+  while (v >= 0x80)
+  {
+    data.push_back(char((v & 0x7f) | 0x80));
+    v >>= 7;
+  }
+  data.push_back(char(v));
+}
+
+// 途中で終わっていたらfalse
+// NOTICE 読み込み元は複製しない
+inline bool read(const char* data, size_t size, size_t& ofs, uint32_t& v) noexcept
+{
+  v = 0;
+  for (int shift = 0; shift < 35; shift += 7)
+  {
+    if (ofs == size) return false;
+
+    auto c = u_char(data[ofs++]);
+    v |= uint32_t(c & 0x7f) << shift;
+    if (!(c & 0x80)) return true;
+  }
+  return false;
+}
+
+} }
@@ -6,6 +6,7 @@
 
 #include <boost/noncopyable.hpp>
 #include <deque>
+#include <set>
 #include <cinder/TriMesh.h>
 #include <cinder/gl/Vbo.h>
 #include <cinder/gl/Batch.h>
@@ -459,13 +460,35 @@ public:
     field_panels_.push_back(panel);
   }
 
+  // 最後に追加したパネルを取り除く
+  void removeLastPanel(const glm::ivec2& pos) noexcept
+  {
+    assert(!field_panels_.empty() && field_panels_.back().field_pos == pos);
+
+    auto& panel = field_panels_.back();
+    timeline_->removeTarget(&panel.position.y);
+    timeline_->removeTarget(&panel.diffuse_power);
+    timeline_->removeTarget(&panel.top_y);
+
+    field_panel_indices_.erase(pos);
+    field_panels_.pop_back();
+  }
+
   // Blank更新
   void updateBlank(const std::vector<glm::ivec2>& blanks) noexcept
   {
+    // TIPS 盤面が広がるとBlankも増えるので、総当たりせずに座標の集合で調べる
+    std::set<glm::ivec2, LessVec<glm::ivec2>> current;
+    for (const auto& b : blank_panels_)
+    {
+      current.insert(b.field_pos);
+    }
+    std::set<glm::ivec2, LessVec<glm::ivec2>> next(std::begin(blanks), std::end(blanks));
+
     // 新しいのを追加
     for (const auto& pos : blanks)
     {
-      if (searchBlank(pos)) continue; 
+      if (current.count(pos)) continue; 
 
       glm::vec3 blank_pos = vec2ToVec3(pos * int(PANEL_SIZE));
       blank_panels_.push_back({ pos, blank_pos });
@@ -489,7 +512,7 @@ public:
 
     for (auto it = std::begin(blank_panels_); it != std::end(blank_panels_); )
     {
-      if (existsBlank(it->field_pos, blanks))
+      if (next.count(it->field_pos))
       {
         ++it;
         continue;
@@ -1057,15 +1080,6 @@ private:
   }
 
   // Blank Panel関連
-  bool searchBlank(const glm::ivec2& pos) noexcept
-  {
-    return std::any_of(std::begin(blank_panels_), std::end(blank_panels_),
-                       [&pos](const auto& it)
-                       {
-                         return it.field_pos == pos; 
-                       });
-  }
-
   Blank* searchBlankPosition(const glm::ivec2& pos) noexcept
   {
     for (auto& b : blank_panels_)
@@ -1075,15 +1089,6 @@ private:
     return nullptr;
   }
 
-  bool existsBlank(const glm::ivec2& pos, const std::vector<glm::ivec2>& blanks) noexcept
-  {
-    return std::any_of(std::begin(blanks), std::end(blanks),
-                       [&pos](const auto& p)
-                       {
-                         return p == pos; 
-                       });
-  }
-
   // 影のレンダリング
   void renderShadow(const Info& info) noexcept
   {
@@ -0,0 +1,243 @@
+﻿#pragma once
+
+//
+// ツール用の小さなJSON読み込み
+//   ci::JsonTreeの代わり
+//   数値は文字列のまま保持して、取り出す時に変換する(uint64_tを欠けずに読むため)
+//   オブジェクトの要素もarrayに並べるので、配列と同じように辿れる
+//
+
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <cstdlib>
+#include <cstdint>
+#include <cstring>
+
+
+namespace MiniJson {
+
+struct Value
+{
+  enum class Type {
+    NUL,
+    BOOL,
+    NUMBER,
+    STRING,
+    ARRAY,
+    OBJECT,
+  };
+
+  Type type = Type::NUL;
+  bool boolean = false;
+  // 数値と文字列
+  std::string text;
+  std::vector<Value> array;
+  // オブジェクトの場合のキー(arrayと同じ並び)
+  std::vector<std::string> keys;
+
+
+  bool has(const std::string& key) const
+  {
+    return std::find(std::begin(keys), std::end(keys), key) != std::end(keys);
+  }
+
+  // 無い場合はNUL
+  const Value& operator[](const std::string& key) const
+  {
+    static const Value null;
+    auto it = std::find(std::begin(keys), std::end(keys), key);
+    return (it != std::end(keys)) ? array[it - std::begin(keys)] : null;
+  }
+
+  const Value& operator[](size_t index) const
+  {
+    return array[index];
+  }
+
+  size_t size() const
+  {
+    return array.size();
+  }
+
+  double asDouble() const
+  {
+    return std::strtod(text.c_str(), nullptr);
+  }
+
+  int64_t asInt() const
+  {
+    return std::strtoll(text.c_str(), nullptr, 10);
+  }
+
+  uint64_t asUInt64() const
+  {
+    return std::strtoull(text.c_str(), nullptr, 10);
+  }
+
+  bool asBool() const
+  {
+    return boolean;
+  }
+};
+
+
+namespace detail {
+
+struct Parser
+{
+  const char* p;
+  const char* end;
+
+  void skip()
+  {
+    while (p < end && (*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r')) ++p;
+  }
+
+  bool expect(char c)
+  {
+    skip();
+    if (p == end || *p != c) return false;
+    ++p;
+    return true;
+  }
+
+  bool literal(const char* word)
+  {
+    for ( ; *word; ++word, ++p)
+    {
+      if (p == end || *p != *word) return false;
+    }
+    return true;
+  }
+
+  bool string(std::string& out)
+  {
+    if (!expect('"')) return false;
+    while (p < end && *p != '"')
+    {
+      if (*p == '\\')
+      {
+        ++p;
+        if (p == end) return false;
+        switch (*p)
+        {
+        case 'n': out.push_back('\n'); break;
+        case 't': out.push_back('\t'); break;
+        case 'r': out.push_back('\r'); break;
+        case 'b': out.push_back('\b'); break;
+        case 'f': out.push_back('\f'); break;
+        case 'u':
+          {
+            // NOTICE 記録には出てこないのでASCII範囲のみ
+            if (end - p < 5) return false;
+            auto code = std::strtoul(std::string(p + 1, p + 5).c_str(), nullptr, 16);
+            out.push_back(char(code & 0x7f));
+            p += 4;
+          }
+          break;
+        default:  out.push_back(*p); break;
+        }
+        ++p;
+      }
+      else
+      {
+        out.push_back(*p++);
+      }
+    }
+    return expect('"');
+  }
+
+  bool value(Value& v)
+  {
+    skip();
+    if (p == end) return false;
+
+    switch (*p)
+    {
+    case '{':
+      {
+        ++p;
+        v.type = Value::Type::OBJECT;
+        skip();
+        if (p < end && *p == '}')
+        {
+          ++p;
+          return true;
+        }
+        do
+        {
+          v.keys.emplace_back();
+          v.array.emplace_back();
+          if (!string(v.keys.back()) || !expect(':')) return false;
+          if (!value(v.array.back())) return false;
+        }
+        while (expect(','));
+        return expect('}');
+      }
+
+    case '[':
+      {
+        ++p;
+        v.type = Value::Type::ARRAY;
+        skip();
+        if (p < end && *p == ']')
+        {
+          ++p;
+          return true;
+        }
+        do
+        {
+          v.array.emplace_back();
+          if (!value(v.array.back())) return false;
+        }
+        while (expect(','));
+        return expect(']');
+      }
+
+    case '"':
+      v.type = Value::Type::STRING;
+      return string(v.text);
+
+    case 't':
+      v.type    = Value::Type::BOOL;
+      v.boolean = true;
+      return literal("true");
+
+    case 'f':
+      v.type    = Value::Type::BOOL;
+      v.boolean = false;
+      return literal("false");
+
+    case 'n':
+      v.type = Value::Type::NUL;
+      return literal("null");
+
+    default:
+      {
+        v.type = Value::Type::NUMBER;
+        auto begin = p;
+        while (p < end && ((*p && std::strchr("+-.eE", *p)) || (*p >= '0' && *p <= '9'))) ++p;
+        v.text.assign(begin, p);
+        return !v.text.empty();
+      }
+    }
+  }
+};
+
+}
+
+// 読み込みに失敗したらfalse
+inline bool parse(const std::string& text, Value& root)
+{
+  detail::Parser parser { text.data(), text.data() + text.size() };
+  // BOM付きも読める
+  if (text.compare(0, 3, "\xef\xbb\xbf") == 0) parser.p += 3;
+
+  root = Value();
+  if (!parser.value(root)) return false;
+  parser.skip();
+  return parser.p == parser.end;
+}
+
+}
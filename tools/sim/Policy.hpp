@@ -0,0 +1,83 @@
+﻿#pragma once
+
+//
+// 自動で遊ぶ時のパネルを置く場所の決め方
+//   runnerとdealerで共有する
+//
+
+#include <vector>
+#include <random>
+#include "Simulator.hpp"
+
+
+namespace ngs {
+
+// パネルを置く場所の決め方
+enum class Policy {
+  RANDOM,
+  GREEDY,
+  NEAREST,
+};
+
+
+// 置く場所を決める
+inline std::pair<glm::ivec2, u_int> choosePlace(Policy policy, const Simulator& sim,
+                                                const std::vector<std::pair<glm::ivec2, u_int>>& places,
+                                                const glm::ivec2& last_pos, std::mt19937& engine)
+{
+  switch (policy)
+  {
+  case Policy::RANDOM:
+    break;
+
+  case Policy::GREEDY:
+    {
+      // 置いた直後のスコアが一番高い場所
+      // TIPS 複製は１回だけにして、置いては取り消す
+      Simulator s = sim;
+      s.setUndoEnabled(true);
+
+      std::vector<size_t> best;
+      u_int best_score = 0;
+      for (size_t i = 0; i < places.size(); ++i)
+      {
+        s.hand_rotation = places[i].second;
+        s.putHandPanel(places[i].first);
+        s.checkCompleted(places[i].first);
+
+        auto score = s.calcTotalScore();
+        s.undo();
+        if (best.empty() || score > best_score)
+        {
+          best.clear();
+          best_score = score;
+        }
+        if (score == best_score) best.push_back(i);
+      }
+      return places[best[engine() % best.size()]];
+    }
+
+  case Policy::NEAREST:
+    {
+      // 前回置いた場所から一番近い場所(Game::getNextPanelPositionと同じ)
+      std::vector<size_t> best;
+      int best_d = 0;
+      for (size_t i = 0; i < places.size(); ++i)
+      {
+        auto d = last_pos - places[i].first;
+        int dd = d.x * d.x + d.y * d.y;
+        if (best.empty() || dd < best_d)
+        {
+          best.clear();
+          best_d = dd;
+        }
+        if (dd == best_d) best.push_back(i);
+      }
+      return places[best[engine() % best.size()]];
+    }
+  }
+
+  return places[engine() % places.size()];
+}
+
+}
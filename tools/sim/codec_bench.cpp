@@ -0,0 +1,249 @@
+﻿//
+// 圧縮(TextCodec)の速さを以前の実装と比べるやつ
+//   records.jsonに似たデータを作って、圧縮と伸長を繰り返す
+//
+// codec_bench [options]
+//   --sizes a,b,...     データの大きさ(KB)
+//   --seconds x         １つの計測にかける時間
+//
+// 以前の実装
+//   呼び出しごとにzlibを初期化し、8KBずつ一時領域から書き出し先へ足していく
+//
+
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <random>
+#include <chrono>
+#include <cassert>
+#include <zlib.h>
+#include "TextCodec.hpp"
+
+
+namespace {
+
+struct Options
+{
+  std::vector<size_t> sizes { 4, 64, 1024 };
+  double seconds = 1.0;
+};
+
+
+bool parseOptions(int argc, char* argv[], Options& options)
+{
+  for (int i = 1; i < argc; ++i)
+  {
+    std::string name = argv[i];
+    if (i + 1 == argc)
+    {
+      std::cerr << "missing value: " << name << std::endl;
+      return false;
+    }
+    std::string value = argv[++i];
+
+    if (name == "--sizes")
+    {
+      options.sizes.clear();
+      std::istringstream is(value);
+      std::string v;
+      while (std::getline(is, v, ','))
+      {
+        options.sizes.push_back(std::stoull(v));
+      }
+    }
+    else if (name == "--seconds")
+    {
+      options.seconds = std::stod(value);
+    }
+    else
+    {
+      std::cerr << "unknown option: " << name << std::endl;
+      return false;
+    }
+  }
+
+  return !options.sizes.empty();
+}
+
+
+namespace Legacy {
+
+enum {
+  OUTBUFSIZ = 1024 * 8,
+};
+
+std::string encode(const std::string& input)
+{
+  z_stream z;
+  z.zalloc = Z_NULL;
+  z.zfree  = Z_NULL;
+  z.opaque = Z_NULL;
+  deflateInit(&z, Z_DEFAULT_COMPRESSION);
+
+  z.next_in  = const_cast<Bytef*>(reinterpret_cast<const Bytef*>(input.c_str()));
+  z.avail_in = static_cast<unsigned int>(input.size());
+
+  Bytef outbuf[OUTBUFSIZ];
+  z.next_out  = outbuf;
+  z.avail_out = OUTBUFSIZ;
+
+  std::string output;
+  while (1)
+  {
+    int status = deflate(&z, Z_FINISH);
+    assert(status != Z_STREAM_ERROR);
+
+    if ((z.avail_out == 0) || (status == Z_STREAM_END))
+    {
+      u_int count = OUTBUFSIZ - z.avail_out;
+      output.insert(output.end(), &outbuf[0], &outbuf[count]);
+
+      if (status == Z_STREAM_END) break;
+
+      z.next_out  = outbuf;
+      z.avail_out = OUTBUFSIZ;
+    }
+  }
+  deflateEnd(&z);
+
+  return output;
+}
+
+std::string decode(const std::string& input)
+{
+  z_stream z;
+  z.zalloc = Z_NULL;
+  z.zfree  = Z_NULL;
+  z.opaque = Z_NULL;
+  inflateInit(&z);
+
+  z.next_in  = const_cast<Bytef*>(reinterpret_cast<const Bytef*>(input.c_str()));
+  z.avail_in = static_cast<unsigned int>(input.size());
+
+  Bytef outbuf[OUTBUFSIZ];
+  z.next_out  = outbuf;
+  z.avail_out = OUTBUFSIZ;
+
+  std::string output;
+  while (1) {
+    int status = inflate(&z, Z_NO_FLUSH);
+    if ((status == Z_STREAM_ERROR) || (status == Z_DATA_ERROR))
+    {
+      inflateEnd(&z);
+      return std::string();
+    }
+
+    if ((z.avail_out == 0) || (status == Z_STREAM_END))
+    {
+      u_int count = OUTBUFSIZ - z.avail_out;
+      output.insert(output.end(), &outbuf[0], &outbuf[count]);
+
+      if (status == Z_STREAM_END) break;
+
+      z.next_out  = outbuf;
+      z.avail_out = OUTBUFSIZ;
+    }
+  }
+  inflateEnd(&z);
+
+  return output;
+}
+
+}
+
+
+// records.jsonに似たデータ
+std::string createRecords(size_t size)
+{
+  std::mt19937 engine(size);
+  std::ostringstream os;
+  os << "{\n  \"version\": 1,\n  \"play-times\": " << engine() % 1000
+     << ",\n  \"high-score\": " << engine() % 100000
+     << ",\n  \"games\": [\n";
+
+  bool first = true;
+  while (size_t(os.tellp()) < size)
+  {
+    if (!first) os << ",\n";
+    first = false;
+
+    os << "    {\n"
+       << "      \"score\": " << engine() % 100000 << ",\n"
+       << "      \"rank\": " << engine() % 10 << ",\n"
+       << "      \"total-panels\": " << engine() % 64 << ",\n"
+       << "      \"play-time\": " << std::setprecision(8) << std::uniform_real_distribution<double>(30, 300)(engine) << ",\n"
+       << "      \"date\": \"2018-" << engine() % 12 + 1 << "-" << engine() % 28 + 1 << "\"\n"
+       << "    }";
+  }
+  os << "\n  ]\n}\n";
+
+  return os.str();
+}
+
+
+// 指定時間繰り返して、１秒あたりに処理した大きさ(MB)を返す
+template <typename F>
+double measure(double seconds, size_t size, F func)
+{
+  using clock = std::chrono::steady_clock;
+
+  size_t count = 0;
+  auto start = clock::now();
+  double elapsed = 0;
+  do
+  {
+    func();
+    ++count;
+    elapsed = std::chrono::duration<double>(clock::now() - start).count();
+  }
+  while (elapsed < seconds);
+
+  return double(size) * count / elapsed / (1024.0 * 1024.0);
+}
+
+}
+
+
+int main(int argc, char* argv[])
+{
+  using namespace ngs;
+
+  Options options;
+  if (!parseOptions(argc, argv, options))
+  {
+    std::cerr << "usage: codec_bench [--sizes a,b,...] [--seconds x]" << std::endl;
+    return 1;
+  }
+
+  std::cout << std::fixed << std::setprecision(1);
+  for (auto kb : options.sizes)
+  {
+    auto text = createRecords(kb * 1024);
+
+    auto legacy_data = Legacy::encode(text);
+    auto data        = TextCodec::encode(text);
+    if (Legacy::decode(legacy_data) != text
+        || TextCodec::decode(data) != text
+        || TextCodec::decode(legacy_data) != text)
+    {
+      std::cerr << "round trip failed: " << kb << " KB" << std::endl;
+      return 1;
+    }
+
+    // NOTICE 伸長は元の大きさあたりで比べる
+    auto legacy_encode = measure(options.seconds, text.size(), [&]() { Legacy::encode(text); });
+    auto new_encode    = measure(options.seconds, text.size(), [&]() { TextCodec::encode(text); });
+    auto legacy_decode = measure(options.seconds, text.size(), [&]() { Legacy::decode(legacy_data); });
+    auto new_decode    = measure(options.seconds, text.size(), [&]() { TextCodec::decode(data); });
+
+    std::cout << text.size() << " bytes -> " << legacy_data.size() << " / " << data.size() << " bytes\n"
+              << "  encode: " << legacy_encode << " -> " << new_encode << " MB/s"
+              << " (x" << std::setprecision(2) << new_encode / legacy_encode << std::setprecision(1) << ")\n"
+              << "  decode: " << legacy_decode << " -> " << new_decode << " MB/s"
+              << " (x" << std::setprecision(2) << new_decode / legacy_decode << std::setprecision(1) << ")\n";
+  }
+
+  return 0;
+}
@@ -0,0 +1,401 @@
+﻿//
+// 日替わりの配りを選ぶやつ
+//   乱数の種を並列に調べて、配りごとに自動で遊ばせて難しさを見積もる
+//   選んだ配りは、params.jsonのgameにそのまま貼れる書式で書き出す
+//
+// dealer [options]
+//   --seed N            最初に調べる乱数の種
+//   --count N           調べる配りの数
+//   --threads N         スレッド数(0でコア数)
+//   --random N          １つの配りをランダムに遊ぶ回数
+//   --greedy N          選んだ配りを貪欲に遊ぶ回数
+//   --select N          選ぶ配りの数
+//   --min-difficulty x  選ぶ難しさの範囲[0, 1]
+//   --max-difficulty x
+//   --out PATH          書き出すファイル(省略時は標準出力)
+//
+// 書き出す値(配りごとに１行)
+//   [ 乱数の種, 難しさ, 期待スコア(貪欲), Perfectが取れたか, パネルを飛ばした回数(１ゲームの平均) ]
+//
+// TIPS 全ての配りはランダムに遊ぶだけで絞り込み、時間のかかる貪欲は選んだ配りだけで遊ぶ
+//
+
+#include <iostream>
+#include <fstream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <numeric>
+#include <algorithm>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include "Simulator.hpp"
+#include "Policy.hpp"
+
+
+using namespace ngs;
+
+namespace {
+
+struct Options
+{
+  uint32_t seed = 1;
+  size_t count  = 10000;
+  u_int threads = 0;
+  u_int random  = 4;
+  u_int greedy  = 1;
+  size_t select = 30;
+  float min_difficulty = 0.0f;
+  float max_difficulty = 1.0f;
+
+  // params.jsonと同じ値
+  Rule rule {
+    { 1.7f, 0.3f },
+    { 250.0f, 800.0f, 1.5f, 1000.0f, 5000.0f, 50.0f },
+    { 351.564f, 0.0555555f, 8000.0f },
+    1.1f,
+  };
+
+  std::string out_path;
+};
+
+// 調べた配り
+struct Deal
+{
+  uint32_t seed;
+
+  // ランダムに遊んだ時の平均
+  float random_score;
+  float skipped;
+  // どれかのゲームで全て置けた
+  bool perfect;
+
+  // 0(易しい)〜1(難しい)
+  float difficulty;
+  // 貪欲に遊んだ時の平均
+  float greedy_score;
+};
+
+
+bool parseOptions(int argc, char* argv[], Options& options)
+{
+  for (int i = 1; i < argc; ++i)
+  {
+    std::string name = argv[i];
+    if (i + 1 == argc)
+    {
+      std::cerr << "missing value: " << name << std::endl;
+      return false;
+    }
+    std::string value = argv[++i];
+
+    if (name == "--seed")
+    {
+      options.seed = std::stoul(value);
+    }
+    else if (name == "--count")
+    {
+      options.count = std::stoull(value);
+    }
+    else if (name == "--threads")
+    {
+      options.threads = std::stoul(value);
+    }
+    else if (name == "--random")
+    {
+      options.random = std::stoul(value);
+    }
+    else if (name == "--greedy")
+    {
+      options.greedy = std::stoul(value);
+    }
+    else if (name == "--select")
+    {
+      options.select = std::stoull(value);
+    }
+    else if (name == "--min-difficulty")
+    {
+      options.min_difficulty = std::stof(value);
+    }
+    else if (name == "--max-difficulty")
+    {
+      options.max_difficulty = std::stof(value);
+    }
+    else if (name == "--out")
+    {
+      options.out_path = value;
+    }
+    else
+    {
+      std::cerr << "unknown option: " << name << std::endl;
+      return false;
+    }
+  }
+
+  return true;
+}
+
+
+// [0, num)をスレッドで分けて処理する
+template <typename F>
+void parallelFor(size_t num, u_int threads, F func)
+{
+  std::atomic<size_t> next(0);
+  // TIPS 少しずつ取り出すことで、早く終わったスレッドが残りを引き受ける
+  const size_t chunk = 16;
+
+  std::vector<std::thread> workers;
+  for (u_int t = 0; t < threads; ++t)
+  {
+    workers.emplace_back([&]()
+                         {
+                           while (true)
+                           {
+                             size_t begin = next.fetch_add(chunk);
+                             if (begin >= num) break;
+
+                             size_t end = std::min(begin + chunk, num);
+                             for (size_t i = begin; i < end; ++i)
+                             {
+                               func(i);
+                             }
+                           }
+                         });
+  }
+  for (auto& w : workers)
+  {
+    w.join();
+  }
+}
+
+
+// 配りを最後まで遊ぶ
+// start: 最初のパネルを置いた状態(Gameと同じ手順で用意したもの)
+void playDeal(const Simulator& start, Policy policy, uint32_t seed,
+              float& score, bool& perfect, u_int& skipped)
+{
+  Simulator sim = start;
+  // 置く場所を決める時の乱数
+  std::mt19937 engine(seed);
+
+  glm::ivec2 last_pos(0, 0);
+  while (sim.getNextPanel())
+  {
+    auto places = sim.searchHandPanelPlaces();
+    auto place  = choosePlace(policy, sim, places, last_pos, engine);
+
+    sim.hand_rotation = place.second;
+    sim.putHandPanel(place.first);
+    sim.checkCompleted(place.first);
+    last_pos = place.first;
+  }
+
+  score   = float(sim.calcTotalScore());
+  perfect = sim.isPerfect();
+  skipped = sim.skipped_panels;
+}
+
+Simulator prepareDeal(const Options& options, const std::vector<Panel>& panels, uint32_t seed)
+{
+  // NOTICE Game::preparationPanelと同じ手順
+  Simulator sim(options.rule, panels, seed);
+  sim.preparationPanel();
+  sim.putFirstPanel();
+  return sim;
+}
+
+// ランダムに遊んで見積もる
+void estimateDeal(const Options& options, const std::vector<Panel>& panels, Deal& deal)
+{
+  auto start = prepareDeal(options, panels, deal.seed);
+
+  float score_sum = 0;
+  u_int skipped_sum = 0;
+  deal.perfect = false;
+  for (u_int i = 0; i < options.random; ++i)
+  {
+    float score;
+    bool perfect;
+    u_int skipped;
+    playDeal(start, Policy::RANDOM, deal.seed ^ (0x9e3779b9 * (i + 1)), score, perfect, skipped);
+
+    score_sum   += score;
+    skipped_sum += skipped;
+    deal.perfect = deal.perfect || perfect;
+  }
+
+  deal.random_score = score_sum / options.random;
+  deal.skipped      = float(skipped_sum) / options.random;
+}
+
+// 貪欲に遊んで期待スコアを求める
+void evaluateDeal(const Options& options, const std::vector<Panel>& panels, Deal& deal)
+{
+  auto start = prepareDeal(options, panels, deal.seed);
+
+  float score_sum = 0;
+  for (u_int i = 0; i < options.greedy; ++i)
+  {
+    float score;
+    bool perfect;
+    u_int skipped;
+    playDeal(start, Policy::GREEDY, deal.seed ^ (0x85ebca6b * (i + 1)), score, perfect, skipped);
+
+    score_sum   += score;
+    deal.perfect = deal.perfect || perfect;
+  }
+
+  deal.greedy_score = options.greedy ? score_sum / options.greedy : deal.random_score;
+}
+
+// 難しさ
+//   ランダムに遊んだ時の平均スコアが、全ての配りの中で何番目に低いか
+//   同じ点なら飛ばした回数が多い方を難しくする
+void rankDifficulty(std::vector<Deal>& deals)
+{
+  std::vector<size_t> order(deals.size());
+  std::iota(std::begin(order), std::end(order), 0);
+  std::sort(std::begin(order), std::end(order),
+            [&deals](size_t a, size_t b)
+            {
+              const auto& da = deals[a];
+              const auto& db = deals[b];
+              if (da.random_score != db.random_score) return da.random_score > db.random_score;
+              if (da.skipped != db.skipped) return da.skipped < db.skipped;
+              return da.seed < db.seed;
+            });
+
+  for (size_t i = 0; i < order.size(); ++i)
+  {
+    deals[order[i]].difficulty = (order.size() > 1) ? float(i) / (order.size() - 1) : 0.0f;
+  }
+}
+
+// 難しさが範囲内に均等に散らばるように選ぶ
+// NOTICE Perfectが取れなかった配りは選ばない
+std::vector<size_t> selectDeals(const Options& options, const std::vector<Deal>& deals)
+{
+  std::vector<size_t> candidates;
+  for (size_t i = 0; i < deals.size(); ++i)
+  {
+    if (deals[i].perfect) candidates.push_back(i);
+  }
+  std::sort(std::begin(candidates), std::end(candidates),
+            [&deals](size_t a, size_t b)
+            {
+              return deals[a].difficulty < deals[b].difficulty;
+            });
+
+  std::vector<size_t> selected;
+  std::vector<char> used(candidates.size(), 0);
+  auto num = std::min(options.select, candidates.size());
+  for (size_t k = 0; k < num; ++k)
+  {
+    float target = options.min_difficulty
+                 + (options.max_difficulty - options.min_difficulty) * (k + 0.5f) / num;
+
+    // 目標に一番近い、まだ選んでいない配り
+    auto it = std::lower_bound(std::begin(candidates), std::end(candidates), target,
+                               [&deals](size_t i, float v)
+                               {
+                                 return deals[i].difficulty < v;
+                               });
+    auto hi = size_t(it - std::begin(candidates));
+    auto lo = hi;
+    while (true)
+    {
+      bool has_lo = lo > 0;
+      bool has_hi = hi < candidates.size();
+      if (!has_lo && !has_hi) break;
+
+      size_t pick;
+      if (has_lo && (!has_hi || target - deals[candidates[lo - 1]].difficulty < deals[candidates[hi]].difficulty - target))
+      {
+        pick = --lo;
+      }
+      else
+      {
+        pick = hi++;
+      }
+
+      if (!used[pick])
+      {
+        used[pick] = 1;
+        selected.push_back(candidates[pick]);
+        break;
+      }
+    }
+  }
+
+  return selected;
+}
+
+}
+
+
+int main(int argc, char* argv[])
+{
+  Options options;
+  if (!parseOptions(argc, argv, options) || options.count == 0 || options.random == 0)
+  {
+    std::cerr << "usage: dealer [--seed N] [--count N] [--threads N] [--random N] [--greedy N] [--select N]"
+                 " [--min-difficulty x] [--max-difficulty x] [--out PATH]" << std::endl;
+    return 1;
+  }
+
+  u_int threads = options.threads ? options.threads : std::max(std::thread::hardware_concurrency(), 1u);
+  const auto& panels = createPanels();
+
+  // 全ての配りをランダムに遊ぶ
+  // NOTICE 配りごとに結果の場所が決まっているので、スレッド数によらず同じ結果になる
+  std::vector<Deal> deals(options.count);
+  auto start_time = std::chrono::steady_clock::now();
+  parallelFor(deals.size(), threads,
+              [&](size_t i)
+              {
+                deals[i].seed = options.seed + uint32_t(i);
+                estimateDeal(options, panels, deals[i]);
+              });
+  auto estimate_time = std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count();
+
+  rankDifficulty(deals);
+  auto selected = selectDeals(options, deals);
+
+  // 選んだ配りだけ貪欲に遊ぶ
+  parallelFor(selected.size(), threads,
+              [&](size_t i)
+              {
+                evaluateDeal(options, panels, deals[selected[i]]);
+              });
+  auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count();
+
+  std::sort(std::begin(selected), std::end(selected),
+            [&deals](size_t a, size_t b)
+            {
+              return deals[a].seed < deals[b].seed;
+            });
+
+  std::cerr << options.count << " deals, " << threads << " threads, "
+            << estimate_time << " sec (" << options.count / estimate_time << " deals/sec)" << std::endl;
+  std::cerr << selected.size() << " selected, " << elapsed << " sec total" << std::endl;
+
+  std::ofstream file;
+  if (!options.out_path.empty()) file.open(options.out_path);
+  std::ostream& os = options.out_path.empty() ? std::cout : file;
+
+  os << "\"daily\": [\n";
+  for (size_t i = 0; i < selected.size(); ++i)
+  {
+    const auto& deal = deals[selected[i]];
+    os << "  [ " << deal.seed
+       << ", " << std::fixed << std::setprecision(3) << deal.difficulty
+       << ", " << std::setprecision(0) << deal.greedy_score
+       << ", " << (deal.perfect ? 1 : 0)
+       << ", " << std::setprecision(2) << deal.skipped
+       << " ]" << ((i + 1 < selected.size()) ? "," : "") << '\n';
+  }
+  os << "]\n";
+
+  return 0;
+}
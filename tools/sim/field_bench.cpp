@@ -0,0 +1,434 @@
+﻿//
+// Field(升目の塊)の速さを以前の実装(std::map)と比べるやつ
+//   普通のゲームで埋まる盤面と、無理やり広げた大きな盤面で計測する
+//
+// field_bench [options]
+//   --boards N          普通のゲームの盤面の数
+//   --large N           大きな盤面のパネル数
+//   --seed N            乱数の種
+//   --seconds x         １つの計測にかける時間
+//
+// 計測する処理
+//   build    パネルを順に置く
+//   around   置いたパネルの周囲８箇所を調べる(isCompleteChurchと同じ)
+//   putable  置ける場所に４方向の回転で置けるか調べる(以前のcanPutPanelと同じ)
+//
+
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <map>
+#include <set>
+#include <random>
+#include <chrono>
+#include <cstdlib>
+#include "Simulator.hpp"
+
+
+using namespace ngs;
+
+namespace {
+
+struct Options
+{
+  size_t boards  = 100;
+  size_t large   = 10000;
+  uint32_t seed  = 0;
+  double seconds = 1.0;
+};
+
+
+bool parseOptions(int argc, char* argv[], Options& options)
+{
+  for (int i = 1; i < argc; ++i)
+  {
+    std::string name = argv[i];
+    if (i + 1 == argc)
+    {
+      std::cerr << "missing value: " << name << std::endl;
+      return false;
+    }
+    std::string value = argv[++i];
+
+    if (name == "--boards")
+    {
+      options.boards = std::stoull(value);
+    }
+    else if (name == "--large")
+    {
+      options.large = std::stoull(value);
+    }
+    else if (name == "--seed")
+    {
+      options.seed = uint32_t(std::stoul(value));
+    }
+    else if (name == "--seconds")
+    {
+      options.seconds = std::stod(value);
+    }
+    else
+    {
+      std::cerr << "unknown option: " << name << std::endl;
+      return false;
+    }
+  }
+
+  return options.boards > 0 && options.large > 0;
+}
+
+
+namespace Legacy {
+
+// 以前のField(座標をキーにしたstd::map)
+struct Field
+{
+  std::vector<glm::ivec2> searchBlank() const noexcept
+  {
+    std::set<glm::ivec2, LessVec<glm::ivec2>> blank_candidate;
+
+    static const glm::ivec2 offsets[] = {
+      { -1,  0 },
+      {  1,  0 },
+      {  0, -1 },
+      {  0,  1 },
+    };
+
+    for (const auto& pos : panel_pos_array_)
+    {
+      for (const auto& ofs : offsets)
+      {
+        auto p = pos + ofs;
+        if (!panel_status_.count(p))
+        {
+          blank_candidate.insert(p);
+        }
+      }
+    }
+
+    return std::vector<glm::ivec2>(std::begin(blank_candidate), std::end(blank_candidate));
+  }
+
+  bool existsPanel(const glm::ivec2& pos) const noexcept
+  {
+    return panel_status_.count(pos);
+  }
+
+  const PanelStatus& getPanelStatus(const glm::ivec2& pos) const noexcept
+  {
+    return panel_status_.at(pos);
+  }
+
+  void addPanel(int number, const glm::ivec2& pos, u_int rotation, uint64_t edge) noexcept
+  {
+    PanelStatus status = {
+      pos,
+      number,
+      rotation,
+      edge
+    };
+
+    panel_status_.emplace(pos, status);
+    panel_pos_array_.push_back(pos);
+  }
+
+private:
+  std::map<glm::ivec2, PanelStatus, LessVec<glm::ivec2>> panel_status_;
+  std::vector<glm::ivec2> panel_pos_array_;
+};
+
+}
+
+
+// 置いたパネル
+struct Placement
+{
+  int number;
+  glm::ivec2 pos;
+  u_int rotation;
+};
+
+struct Board
+{
+  std::vector<Placement> placements;
+  std::vector<glm::ivec2> blanks;
+};
+
+
+// 両方のFieldに同じ手順で置く
+void addPanel(ngs::Field& field, const std::vector<Panel>& panels, const Placement& p) noexcept
+{
+  const auto& panel = panels[p.number];
+  field.addPanel(p.number, p.pos, p.rotation, panel.getRotatedEdgeValue(p.rotation), panel.getAttribute());
+}
+
+void addPanel(Legacy::Field& field, const std::vector<Panel>& panels, const Placement& p) noexcept
+{
+  field.addPanel(p.number, p.pos, p.rotation, panels[p.number].getRotatedEdgeValue(p.rotation));
+}
+
+template <typename F>
+F buildField(const Board& board, const std::vector<Panel>& panels) noexcept
+{
+  F field;
+  for (const auto& p : board.placements)
+  {
+    addPanel(field, panels, p);
+  }
+  return field;
+}
+
+
+// 普通に遊んだ盤面
+Board playBoard(const std::vector<Panel>& panels, uint32_t seed) noexcept
+{
+  Rule rule {
+    { 1.7f, 0.3f },
+    { 250.0f, 800.0f, 1.5f, 1000.0f, 5000.0f, 50.0f },
+    { 351.564f, 0.0555555f, 8000.0f },
+    1.1f,
+  };
+  Simulator sim(rule, panels, seed);
+  std::mt19937 engine(seed ^ 0x9e3779b9);
+
+  sim.preparationPanel();
+  sim.putFirstPanel();
+  while (sim.getNextPanel())
+  {
+    auto places = sim.searchHandPanelPlaces();
+    const auto& place = places[engine() % places.size()];
+    sim.hand_rotation = place.second;
+    sim.putHandPanel(place.first);
+    sim.checkCompleted(place.first);
+  }
+
+  Board board;
+  for (const auto& status : sim.getField().enumeratePanels())
+  {
+    board.placements.push_back({ status.number, status.position, status.rotation });
+  }
+  return board;
+}
+
+// 置ける場所に無作為にパネルを並べた盤面
+// NOTICE 端が合うかは気にしない(調べる手間は変わらない)
+Board spreadBoard(const std::vector<Panel>& panels, size_t num, uint32_t seed) noexcept
+{
+  std::mt19937 engine(seed);
+  ngs::Field field;
+
+  Board board;
+  Placement first { 0, { 0, 0 }, 0 };
+  board.placements.push_back(first);
+  addPanel(field, panels, first);
+  while (board.placements.size() < num)
+  {
+    const auto& blanks = field.getBlankPositions();
+    Placement p {
+      int(engine() % panels.size()),
+      blanks[engine() % blanks.size()],
+      u_int(engine() % 4)
+    };
+    board.placements.push_back(p);
+    addPanel(field, panels, p);
+  }
+  return board;
+}
+
+
+// 以前のcanPutPanel(周囲のパネルを調べる)
+template <typename F>
+bool scanPutPanel(const Panel& panel, const glm::ivec2& pos, u_int rotation, const F& field) noexcept
+{
+  static const glm::ivec2 offsets[] = {
+    {  0,  1 },
+    {  1,  0 },
+    {  0, -1 },
+    { -1,  0 },
+  };
+
+  auto edge = panel.getRotatedEdgeValue(rotation);
+  auto field_edge = edge;
+
+  for (u_int i = 0; i < 4; ++i)
+  {
+    glm::ivec2 p = pos + offsets[i];
+    if (!field.existsPanel(p)) continue;
+
+    const auto& panel_status = field.getPanelStatus(p);
+    auto field_panel_edge    = rotateLeft(panel_status.edge, 32);
+
+    field_edge = (field_edge & ~(uint64_t(Panel::EDGE_MASK) << (i * 16))) | (field_panel_edge & (uint64_t(Panel::EDGE_MASK) << (i * 16)));
+  }
+
+  return edge == field_edge;
+}
+
+// 周囲８箇所を調べる
+template <typename F>
+int countAround(const Board& board, const F& field) noexcept
+{
+  static const glm::ivec2 offsets[] = {
+    {  0,  1 },
+    {  1,  1 },
+    {  1,  0 },
+    {  1, -1 },
+    {  0, -1 },
+    { -1, -1 },
+    { -1,  0 },
+    { -1,  1 },
+  };
+
+  int count = 0;
+  for (const auto& p : board.placements)
+  {
+    for (const auto& ofs : offsets)
+    {
+      if (field.existsPanel(p.pos + ofs)) count += field.getPanelStatus(p.pos + ofs).number & 1;
+    }
+  }
+  return count;
+}
+
+template <typename F>
+int countPutable(const Board& board, const std::vector<Panel>& panels, const F& field) noexcept
+{
+  int count = 0;
+  for (size_t i = 0; i < board.blanks.size(); ++i)
+  {
+    const auto& panel = panels[i % panels.size()];
+    for (u_int r = 0; r < 4; ++r)
+    {
+      if (scanPutPanel(panel, board.blanks[i], r, field)) ++count;
+    }
+  }
+  return count;
+}
+
+
+// 指定時間繰り返して、１回あたりの時間(ns)を返す
+// NOTICE 結果を使わないと最適化で消されるので、戻り値を足しておく
+template <typename Func>
+double measure(double seconds, size_t ops, Func func, int& sink)
+{
+  using clock = std::chrono::steady_clock;
+
+  size_t count = 0;
+  auto start = clock::now();
+  double elapsed = 0;
+  do
+  {
+    sink += func();
+    ++count;
+    elapsed = std::chrono::duration<double>(clock::now() - start).count();
+  }
+  while (elapsed < seconds);
+
+  return elapsed * 1e9 / (double(count) * ops);
+}
+
+
+// 盤面の組で両方のFieldを計測して表示
+void runBoards(const char* name, const std::vector<Board>& boards, const std::vector<Panel>& panels,
+               const Options& options)
+{
+  size_t panel_num = 0;
+  size_t blank_num = 0;
+  for (const auto& board : boards)
+  {
+    panel_num += board.placements.size();
+    blank_num += board.blanks.size();
+  }
+
+  std::vector<ngs::Field> fields;
+  std::vector<Legacy::Field> legacy_fields;
+  for (const auto& board : boards)
+  {
+    fields.push_back(buildField<ngs::Field>(board, panels));
+    legacy_fields.push_back(buildField<Legacy::Field>(board, panels));
+  }
+
+  // 同じ結果になるか確認
+  for (size_t i = 0; i < boards.size(); ++i)
+  {
+    if (countAround(boards[i], fields[i]) != countAround(boards[i], legacy_fields[i])
+        || countPutable(boards[i], panels, fields[i]) != countPutable(boards[i], panels, legacy_fields[i]))
+    {
+      std::cerr << name << ": result mismatch on board " << i << std::endl;
+      std::exit(1);
+    }
+  }
+
+  int sink = 0;
+  auto each = [&boards](auto func)
+              {
+                return [&boards, func]()
+                       {
+                         int n = 0;
+                         for (size_t i = 0; i < boards.size(); ++i) n += func(i);
+                         return n;
+                       };
+              };
+
+  double results[3][2];
+  results[0][0] = measure(options.seconds, panel_num,
+                          each([&](size_t i) { return int(buildField<Legacy::Field>(boards[i], panels).existsPanel({ 0, 0 })); }), sink);
+  results[0][1] = measure(options.seconds, panel_num,
+                          each([&](size_t i) { return int(buildField<ngs::Field>(boards[i], panels).existsPanel({ 0, 0 })); }), sink);
+  results[1][0] = measure(options.seconds, panel_num * 8,
+                          each([&](size_t i) { return countAround(boards[i], legacy_fields[i]); }), sink);
+  results[1][1] = measure(options.seconds, panel_num * 8,
+                          each([&](size_t i) { return countAround(boards[i], fields[i]); }), sink);
+  results[2][0] = measure(options.seconds, blank_num * 4,
+                          each([&](size_t i) { return countPutable(boards[i], panels, legacy_fields[i]); }), sink);
+  results[2][1] = measure(options.seconds, blank_num * 4,
+                          each([&](size_t i) { return countPutable(boards[i], panels, fields[i]); }), sink);
+
+  static const char* op_names[] = { "build", "around", "putable" };
+  std::cout << name << ": " << boards.size() << " boards, "
+            << panel_num / boards.size() << " panels, " << blank_num / boards.size() << " blanks (" << (sink & 1) << ")\n";
+  for (int i = 0; i < 3; ++i)
+  {
+    std::cout << "  " << std::setw(8) << std::left << op_names[i] << std::right
+              << std::setprecision(1) << results[i][0] << " -> " << results[i][1] << " ns/op"
+              << " (x" << std::setprecision(2) << results[i][0] / results[i][1] << ")\n";
+  }
+}
+
+}
+
+
+int main(int argc, char* argv[])
+{
+  Options options;
+  if (!parseOptions(argc, argv, options))
+  {
+    std::cerr << "usage: field_bench [--boards N] [--large N] [--seed N] [--seconds x]" << std::endl;
+    return 1;
+  }
+
+  const auto& panels = createPanels();
+
+  std::vector<Board> boards;
+  for (size_t i = 0; i < options.boards; ++i)
+  {
+    boards.push_back(playBoard(panels, options.seed + uint32_t(i)));
+  }
+  std::vector<Board> large { spreadBoard(panels, options.large, options.seed) };
+
+  // 置ける場所は以前の実装で求める(並び順を揃える)
+  for (auto* list : { &boards, &large })
+  {
+    for (auto& board : *list)
+    {
+      board.blanks = buildField<Legacy::Field>(board, panels).searchBlank();
+    }
+  }
+
+  std::cout << std::fixed;
+  runBoards("game", boards, panels, options);
+  runBoards("large", large, panels, options);
+
+  return 0;
+}
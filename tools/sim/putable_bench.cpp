@@ -0,0 +1,295 @@
+﻿//
+// 置ける場所と回転の判定の速さを以前の実装と比べるやつ
+//   遊んだゲームの局面ごとに、待ちパネル全ての置ける場所と回転を調べる
+//
+// putable_bench [options]
+//   --games N           遊ぶ回数
+//   --seed N            乱数の種
+//   --seconds x         １つの計測にかける時間
+//
+// 計測する処理
+//   next     次のパネルを決める(先頭から順に、置ける場所があるか調べる)
+//   places   待ちパネル全ての(置ける場所 * 4 + 回転)を調べる
+//
+// 以前の実装
+//   置ける場所ごとに４回canPutPanelを呼び、周囲のパネルの端と比べる
+//
+
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <random>
+#include <chrono>
+#include <cstdlib>
+#include "Simulator.hpp"
+
+
+using namespace ngs;
+
+namespace {
+
+struct Options
+{
+  size_t games   = 100;
+  uint32_t seed  = 0;
+  double seconds = 1.0;
+};
+
+
+bool parseOptions(int argc, char* argv[], Options& options)
+{
+  for (int i = 1; i < argc; ++i)
+  {
+    std::string name = argv[i];
+    if (i + 1 == argc)
+    {
+      std::cerr << "missing value: " << name << std::endl;
+      return false;
+    }
+    std::string value = argv[++i];
+
+    if (name == "--games")
+    {
+      options.games = std::stoull(value);
+    }
+    else if (name == "--seed")
+    {
+      options.seed = uint32_t(std::stoul(value));
+    }
+    else if (name == "--seconds")
+    {
+      options.seconds = std::stod(value);
+    }
+    else
+    {
+      std::cerr << "unknown option: " << name << std::endl;
+      return false;
+    }
+  }
+
+  return options.games > 0;
+}
+
+
+namespace Legacy {
+
+bool canPutPanel(const Panel& panel, const glm::ivec2& pos, u_int rotation, const Field& field) noexcept
+{
+  static const glm::ivec2 offsets[] = {
+    {  0,  1 },
+    {  1,  0 },
+    {  0, -1 },
+    { -1,  0 },
+  };
+
+  auto edge = panel.getRotatedEdgeValue(rotation);
+  auto field_edge = edge;
+
+  for (u_int i = 0; i < 4; ++i)
+  {
+    glm::ivec2 p = pos + offsets[i];
+    if (!field.existsPanel(p)) continue;
+
+    const auto& panel_status = field.getPanelStatus(p);
+    auto field_panel_edge    = rotateLeft(panel_status.edge, 32);
+
+    field_edge = (field_edge & ~(uint64_t(Panel::EDGE_MASK) << (i * 16))) | (field_panel_edge & (uint64_t(Panel::EDGE_MASK) << (i * 16)));
+  }
+
+  return edge == field_edge;
+}
+
+bool canPanelPutField(const Panel& panel, const std::vector<glm::ivec2>& blank, const Field& field) noexcept
+{
+  for (const auto& pos : blank)
+  {
+    for (u_int i = 0; i < 4; ++i)
+    {
+      if (Legacy::canPutPanel(panel, pos, i, field))
+      {
+        return true;
+      }
+    }
+  }
+  return false;
+}
+
+// 先頭から順に調べて、置けるパネルの位置を返す
+int findNextPanel(const std::vector<int>& waiting, const std::vector<Panel>& panels, const Field& field) noexcept
+{
+  const auto& blank = field.getBlankPositions();
+  for (size_t i = 0; i < waiting.size(); ++i)
+  {
+    if (Legacy::canPanelPutField(panels[waiting[i]], blank, field)) return int(i);
+  }
+  return -1;
+}
+
+std::vector<std::vector<bool>> searchPutablePlaces(const std::vector<int>& numbers,
+                                                   const std::vector<Panel>& panels, const Field& field) noexcept
+{
+  const auto& blank = field.getBlankPositions();
+
+  std::vector<std::vector<bool>> putable;
+  for (auto number : numbers)
+  {
+    std::vector<bool> bits(blank.size() * 4);
+    for (size_t i = 0; i < blank.size(); ++i)
+    {
+      for (u_int r = 0; r < 4; ++r)
+      {
+        bits[i * 4 + r] = Legacy::canPutPanel(panels[number], blank[i], r, field);
+      }
+    }
+    putable.push_back(std::move(bits));
+  }
+  return putable;
+}
+
+}
+
+
+// 局面(パネルを置く直前)
+struct Position
+{
+  Field field;
+  std::vector<int> waiting;
+};
+
+std::vector<Position> playGame(const std::vector<Panel>& panels, uint32_t seed) noexcept
+{
+  Rule rule {
+    { 1.7f, 0.3f },
+    { 250.0f, 800.0f, 1.5f, 1000.0f, 5000.0f, 50.0f },
+    { 351.564f, 0.0555555f, 8000.0f },
+    1.1f,
+  };
+  Simulator sim(rule, panels, seed);
+  std::mt19937 engine(seed ^ 0x9e3779b9);
+
+  std::vector<Position> positions;
+  sim.preparationPanel();
+  sim.putFirstPanel();
+  while (true)
+  {
+    positions.push_back({ sim.getField(), sim.waiting_panels });
+    if (!sim.getNextPanel()) break;
+
+    auto places = sim.searchHandPanelPlaces();
+    const auto& place = places[engine() % places.size()];
+    sim.hand_rotation = place.second;
+    sim.putHandPanel(place.first);
+    sim.checkCompleted(place.first);
+  }
+  return positions;
+}
+
+
+// 指定時間繰り返して、１局面あたりの時間(ns)を返す
+// NOTICE 結果を使わないと最適化で消されるので、戻り値を足しておく
+template <typename Func>
+double measure(double seconds, size_t num, Func func, size_t& sink)
+{
+  using clock = std::chrono::steady_clock;
+
+  size_t count = 0;
+  auto start = clock::now();
+  double elapsed = 0;
+  do
+  {
+    for (size_t i = 0; i < num; ++i)
+    {
+      sink += func(i);
+    }
+    ++count;
+    elapsed = std::chrono::duration<double>(clock::now() - start).count();
+  }
+  while (elapsed < seconds);
+
+  return elapsed * 1e9 / (double(count) * num);
+}
+
+}
+
+
+int main(int argc, char* argv[])
+{
+  Options options;
+  if (!parseOptions(argc, argv, options))
+  {
+    std::cerr << "usage: putable_bench [--games N] [--seed N] [--seconds x]" << std::endl;
+    return 1;
+  }
+
+  const auto& panels = createPanels();
+  PanelTypes types(panels);
+
+  std::vector<Position> positions;
+  for (size_t i = 0; i < options.games; ++i)
+  {
+    auto p = playGame(panels, options.seed + uint32_t(i));
+    positions.insert(std::end(positions), std::begin(p), std::end(p));
+  }
+
+  // 同じ結果になるか確認
+  size_t blank_num = 0;
+  for (const auto& p : positions)
+  {
+    blank_num += p.field.getBlankPositions().size();
+
+    auto legacy = Legacy::searchPutablePlaces(p.waiting, panels, p.field);
+    auto masks  = searchPutablePlaces(p.waiting, panels, p.field);
+    for (size_t k = 0; k < p.waiting.size(); ++k)
+    {
+      for (size_t i = 0; i < masks[k].size(); ++i)
+      {
+        for (u_int r = 0; r < 4; ++r)
+        {
+          if (legacy[k][i * 4 + r] != bool((masks[k][i] >> r) & 1))
+          {
+            std::cerr << "places mismatch" << std::endl;
+            return 1;
+          }
+        }
+      }
+    }
+    if (Legacy::findNextPanel(p.waiting, panels, p.field) != findNextPanel(p.waiting, panels, types, p.field))
+    {
+      std::cerr << "next panel mismatch" << std::endl;
+      return 1;
+    }
+  }
+
+  size_t sink = 0;
+  auto num = positions.size();
+  auto legacy_next = measure(options.seconds, num,
+                             [&](size_t i)
+                             {
+                               return size_t(Legacy::findNextPanel(positions[i].waiting, panels, positions[i].field));
+                             }, sink);
+  auto new_next    = measure(options.seconds, num,
+                             [&](size_t i)
+                             {
+                               return size_t(findNextPanel(positions[i].waiting, panels, types, positions[i].field));
+                             }, sink);
+  auto legacy_places = measure(options.seconds, num,
+                               [&](size_t i)
+                               {
+                                 return Legacy::searchPutablePlaces(positions[i].waiting, panels, positions[i].field).size();
+                               }, sink);
+  auto new_places    = measure(options.seconds, num,
+                               [&](size_t i)
+                               {
+                                 return searchPutablePlaces(positions[i].waiting, panels, positions[i].field).size();
+                               }, sink);
+
+  std::cout << std::fixed << std::setprecision(1)
+            << num << " positions, " << double(blank_num) / num << " blanks (" << (sink & 1) << ")\n"
+            << "  next    " << legacy_next << " -> " << new_next << " ns/position"
+            << " (x" << std::setprecision(2) << legacy_next / new_next << std::setprecision(1) << ")\n"
+            << "  places  " << legacy_places << " -> " << new_places << " ns/position"
+            << " (x" << std::setprecision(2) << legacy_places / new_places << std::setprecision(1) << ")\n";
+
+  return 0;
+}
@@ -0,0 +1,200 @@
+﻿//
+// 森と道の完成判定(Region)が以前の実装(isCompleteAttribute)と一致するか調べるやつ
+//   乱数の種を変えてゲームを遊ばせ、パネルを置くたびに両方の結果を比べる
+//   一致しなければ終了コード1
+//
+// region_check [options]
+//   --games N           遊ぶ回数(置き方は random / greedy / nearest を順番に使う)
+//   --endless N         無限モードで遊ぶ回数
+//   --moves N           無限モードで置くパネルの数
+//   --seed N            乱数の種(ゲームごとに seed + 通し番号)
+//
+
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include "Simulator.hpp"
+#include "Policy.hpp"
+
+
+using namespace ngs;
+
+namespace {
+
+struct Options
+{
+  size_t games   = 1000;
+  size_t endless = 20;
+  size_t moves   = 500;
+  uint32_t seed  = 0;
+};
+
+
+bool parseOptions(int argc, char* argv[], Options& options)
+{
+  for (int i = 1; i < argc; ++i)
+  {
+    std::string name = argv[i];
+    if (i + 1 == argc)
+    {
+      std::cerr << "missing value: " << name << std::endl;
+      return false;
+    }
+    std::string value = argv[++i];
+
+    if (name == "--games")
+    {
+      options.games = std::stoull(value);
+    }
+    else if (name == "--endless")
+    {
+      options.endless = std::stoull(value);
+    }
+    else if (name == "--moves")
+    {
+      options.moves = std::stoull(value);
+    }
+    else if (name == "--seed")
+    {
+      options.seed = uint32_t(std::stoul(value));
+    }
+    else
+    {
+      std::cerr << "unknown option: " << name << std::endl;
+      return false;
+    }
+  }
+
+  return true;
+}
+
+
+// 1ゲーム遊んで比べる
+// 一致しなければ食い違った内容をerrorに書いてfalse
+bool checkGame(const std::vector<Panel>& panels, uint32_t seed, Policy policy, bool endless, size_t max_moves,
+               size_t& moves, std::string& error)
+{
+  Rule rule {
+    { 1.7f, 0.3f },
+    { 250.0f, 800.0f, 1.5f, 1000.0f, 5000.0f, 50.0f },
+    { 351.564f, 0.0555555f, 8000.0f },
+    1.1f,
+  };
+  Simulator sim(rule, panels, seed);
+  sim.setEndless(endless);
+  std::mt19937 engine(seed ^ 0x9e3779b9);
+
+  sim.preparationPanel();
+  sim.putFirstPanel();
+
+  // 以前の実装で求めた結果を積み上げる
+  std::vector<std::vector<glm::ivec2>> forests;
+  std::vector<u_int> deep_forests;
+  std::vector<std::vector<glm::ivec2>> paths;
+
+  std::ostringstream os;
+  glm::ivec2 last_pos(0, 0);
+  for (size_t n = 0; (n < max_moves) && sim.getNextPanel(); ++n)
+  {
+    auto places = sim.searchHandPanelPlaces();
+    auto place  = choosePlace(policy, sim, places, last_pos, engine);
+
+    sim.hand_rotation = place.second;
+    sim.putHandPanel(place.first);
+    auto completed = sim.checkCompleted(place.first);
+    last_pos = place.first;
+    ++moves;
+
+    const auto& field = sim.getField();
+    auto expected_forests = isCompleteAttribute(Panel::FOREST, place.first, field, panels);
+    auto expected_paths   = isCompleteAttribute(Panel::PATH, place.first, field, panels);
+
+    os << "seed " << seed << " move " << n << " (" << place.first.x << ", " << place.first.y << "): ";
+    if (completed.forests != expected_forests)
+    {
+      os << "forests " << completed.forests.size() << " != " << expected_forests.size();
+      error = os.str();
+      return false;
+    }
+    if (completed.paths != expected_paths)
+    {
+      os << "paths " << completed.paths.size() << " != " << expected_paths.size();
+      error = os.str();
+      return false;
+    }
+    for (const auto& forest : expected_forests)
+    {
+      deep_forests.push_back(countDeepForest(forest, field, panels));
+    }
+    if (!std::equal(std::begin(completed.deep_forests), std::end(completed.deep_forests),
+                    std::end(deep_forests) - expected_forests.size(), std::end(deep_forests)))
+    {
+      os << "deep forest";
+      error = os.str();
+      return false;
+    }
+    appendContainer(expected_forests, forests);
+    appendContainer(expected_paths, paths);
+    os.str("");
+  }
+
+  // 積み上げた結果とスコア
+  const auto& field  = sim.getField();
+  const auto& scores = sim.getScores();
+  os << "seed " << seed << " end: ";
+  if (sim.completed_forests != forests || sim.deep_forest != deep_forests || sim.completed_path != paths)
+  {
+    os << "completed list";
+    error = os.str();
+    return false;
+  }
+  if (int(scores[1]) != countTotalAttribute(paths, field, panels)
+      || int(scores[3]) != countTotalAttribute(forests, field, panels)
+      || int(scores[5]) != countTown(paths, field, panels))
+  {
+    os << "scores";
+    error = os.str();
+    return false;
+  }
+
+  return true;
+}
+
+}
+
+
+int main(int argc, char* argv[])
+{
+  Options options;
+  if (!parseOptions(argc, argv, options))
+  {
+    std::cerr << "usage: region_check [--games N] [--endless N] [--moves N] [--seed N]" << std::endl;
+    return 1;
+  }
+
+  const auto& panels = createPanels();
+  static const Policy policies[] = {
+    Policy::RANDOM,
+    Policy::GREEDY,
+    Policy::NEAREST,
+  };
+
+  size_t games = options.games + options.endless;
+  size_t moves = 0;
+  for (size_t i = 0; i < games; ++i)
+  {
+    bool endless = i >= options.games;
+    std::string error;
+    if (!checkGame(panels, options.seed + uint32_t(i), policies[i % 3], endless,
+                   endless ? options.moves : panels.size(), moves, error))
+    {
+      std::cerr << "mismatch: " << error << std::endl;
+      return 1;
+    }
+  }
+
+  std::cout << games << " games, " << moves << " moves: ok" << std::endl;
+  return 0;
+}
@@ -0,0 +1,166 @@
+﻿//
+// 4方向まとめた置ける判定(getPutableRotation)が以前の実装と一致するか調べるやつ
+//   全てのパネルについて、上下左右の隣の端の組み合わせを全て試す
+//   一致しなければ終了コード1
+//
+// rotation_check
+//
+// 以前の実装
+//   回転ごとにcanPutPanelを呼び、周囲のパネルを調べて端を比べる
+//
+
+#include <iostream>
+#include <vector>
+#include <algorithm>
+#include "Simulator.hpp"
+
+
+using namespace ngs;
+
+namespace {
+
+// 時計回り
+const glm::ivec2 offsets[] = {
+  {  0,  1 },
+  {  1,  0 },
+  {  0, -1 },
+  { -1,  0 },
+};
+
+
+// 以前のcanPutPanel(置ける場所の端情報を使わない)
+bool canPutPanelLegacy(const Panel& panel, const glm::ivec2& pos, u_int rotation, const Field& field) noexcept
+{
+  auto edge = panel.getRotatedEdgeValue(rotation);
+  auto field_edge = edge;
+
+  for (u_int i = 0; i < 4; ++i)
+  {
+    glm::ivec2 p = pos + offsets[i];
+    if (!field.existsPanel(p)) continue;
+
+    const auto& panel_status = field.getPanelStatus(p);
+    auto field_panel_edge    = rotateLeft(panel_status.edge, 32);
+
+    field_edge = (field_edge & ~(uint64_t(Panel::EDGE_MASK) << (i * 16))) | (field_panel_edge & (uint64_t(Panel::EDGE_MASK) << (i * 16)));
+  }
+
+  return edge == field_edge;
+}
+
+
+// 隣に置くパネル
+struct Neighbor
+{
+  int number;
+  u_int rotation;
+};
+
+// 方向ごとに、向かい合う辺の端情報が異なるパネルと回転を集める
+// NOTICE 比べるのは下位16bitだけなので、端情報の値ごとに１つあれば足りる
+std::vector<Neighbor> collectNeighbors(const std::vector<Panel>& panels, u_int direction) noexcept
+{
+  std::vector<Neighbor> neighbors;
+  std::vector<u_int> values;
+
+  u_int facing = (direction + 2) % 4;
+  for (size_t n = 0; n < panels.size(); ++n)
+  {
+    for (u_int r = 0; r < 4; ++r)
+    {
+      auto value = u_int(panels[n].getRotatedEdgeValue(r) >> (facing * 16)) & Panel::EDGE_MASK;
+      if (std::find(std::begin(values), std::end(values), value) != std::end(values)) continue;
+
+      values.push_back(value);
+      neighbors.push_back({ int(n), r });
+    }
+  }
+  return neighbors;
+}
+
+}
+
+
+int main()
+{
+  const auto& panels = createPanels();
+
+  std::vector<Neighbor> neighbors[4];
+  for (u_int i = 0; i < 4; ++i)
+  {
+    neighbors[i] = collectNeighbors(panels, i);
+  }
+
+  // 方向ごとに「隣が無い」か端情報のどれか
+  size_t layouts = 0;
+  size_t checks  = 0;
+  size_t index[4] = {};
+  while (true)
+  {
+    // 隣が１つも無ければ置ける場所ではない
+    if (index[0] || index[1] || index[2] || index[3])
+    {
+      Field field;
+      for (u_int i = 0; i < 4; ++i)
+      {
+        if (!index[i]) continue;
+
+        const auto& n = neighbors[i][index[i] - 1];
+        const auto& p = panels[n.number];
+        field.addPanel(n.number, offsets[i], n.rotation, p.getRotatedEdgeValue(n.rotation), p.getAttribute());
+      }
+
+      glm::ivec2 pos(0, 0);
+      if (!field.isBlank(pos))
+      {
+        std::cerr << "not blank: layout " << layouts << std::endl;
+        return 1;
+      }
+
+      const auto& blank = field.getBlankEdge(pos);
+      for (size_t n = 0; n < panels.size(); ++n)
+      {
+        const auto& panel = panels[n];
+
+        u_int expected = 0;
+        for (u_int r = 0; r < 4; ++r)
+        {
+          if (canPutPanelLegacy(panel, pos, r, field)) expected |= 1 << r;
+        }
+
+        auto rotation = getPutableRotation(panel, blank);
+        if (rotation != expected)
+        {
+          std::cerr << "mismatch: panel " << n
+                    << " neighbors " << index[0] << "," << index[1] << "," << index[2] << "," << index[3]
+                    << " mask " << rotation << " != " << expected << std::endl;
+          return 1;
+        }
+
+        // canPutPanelも置ける場所の端情報を使う
+        for (u_int r = 0; r < 4; ++r)
+        {
+          if (canPutPanel(panel, pos, r, field) != bool((expected >> r) & 1))
+          {
+            std::cerr << "mismatch: canPutPanel panel " << n << " rotation " << r << std::endl;
+            return 1;
+          }
+        }
+        ++checks;
+      }
+      ++layouts;
+    }
+
+    // 次の組み合わせ
+    u_int i = 0;
+    while (i < 4 && ++index[i] > neighbors[i].size())
+    {
+      index[i] = 0;
+      ++i;
+    }
+    if (i == 4) break;
+  }
+
+  std::cout << layouts << " neighbor layouts, " << checks << " panel checks: ok" << std::endl;
+  return 0;
+}
@@ -0,0 +1,367 @@
+﻿//
+// 自動対戦でスコア分布を集計するやつ
+//   ゲームを並列に大量に遊ばせて、得点計算用パラメーターの調整に使う
+//
+// runner [options]
+//   --games N           遊ぶ回数
+//   --threads N         スレッド数(0でコア数)
+//   --seed N            乱数の種(ゲームごとに seed + 通し番号)
+//   --policy NAME       random / greedy / nearest
+//   --panel-rate x,y
+//   --score-rates a,b,c,d,e,f
+//   --ranking-rate x,y,z
+//   --perfect-rate x
+//   --csv PATH          集計結果をCSVで書き出す
+//   --json PATH         集計結果をJSONで書き出す
+//
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include "Simulator.hpp"
+#include "Policy.hpp"
+
+
+using namespace ngs;
+
+namespace {
+
+struct Options
+{
+  size_t games    = 10000;
+  u_int threads   = 0;
+  uint32_t seed   = 0;
+  Policy policy   = Policy::RANDOM;
+
+  // params.jsonと同じ値
+  Rule rule {
+    { 1.7f, 0.3f },
+    { 250.0f, 800.0f, 1.5f, 1000.0f, 5000.0f, 50.0f },
+    { 351.564f, 0.0555555f, 8000.0f },
+    1.1f,
+  };
+
+  std::string csv_path;
+  std::string json_path;
+};
+
+// 1ゲームの結果
+struct Result
+{
+  // scores_ × 7, total_score, total_ranking, perfect
+  enum {
+    SCORES        = 7,
+    TOTAL_SCORE   = SCORES,
+    TOTAL_RANKING,
+    PERFECT,
+
+    NUM
+  };
+
+  u_int values[NUM];
+};
+
+const char* component_names[] = {
+  "path",
+  "path_panels",
+  "forest",
+  "forest_panels",
+  "deep_forest",
+  "town",
+  "church",
+  "total_score",
+  "total_ranking",
+  "perfect",
+};
+
+
+std::vector<float> parseFloats(const std::string& text)
+{
+  std::vector<float> values;
+  std::istringstream is(text);
+  std::string v;
+  while (std::getline(is, v, ','))
+  {
+    values.push_back(std::stof(v));
+  }
+  return values;
+}
+
+bool parseOptions(int argc, char* argv[], Options& options)
+{
+  for (int i = 1; i < argc; ++i)
+  {
+    std::string name = argv[i];
+    if (i + 1 == argc)
+    {
+      std::cerr << "missing value: " << name << std::endl;
+      return false;
+    }
+    std::string value = argv[++i];
+
+    if (name == "--games")
+    {
+      options.games = std::stoull(value);
+    }
+    else if (name == "--threads")
+    {
+      options.threads = std::stoul(value);
+    }
+    else if (name == "--seed")
+    {
+      options.seed = std::stoul(value);
+    }
+    else if (name == "--policy")
+    {
+      if (value == "random")       options.policy = Policy::RANDOM;
+      else if (value == "greedy")  options.policy = Policy::GREEDY;
+      else if (value == "nearest") options.policy = Policy::NEAREST;
+      else
+      {
+        std::cerr << "unknown policy: " << value << std::endl;
+        return false;
+      }
+    }
+    else if (name == "--panel-rate")
+    {
+      auto v = parseFloats(value);
+      if (v.size() != 2) return false;
+      options.rule.panel_rate = glm::vec2(v[0], v[1]);
+    }
+    else if (name == "--score-rates")
+    {
+      auto v = parseFloats(value);
+      if (v.size() != 6) return false;
+      options.rule.score_rates = v;
+    }
+    else if (name == "--ranking-rate")
+    {
+      auto v = parseFloats(value);
+      if (v.size() != 3) return false;
+      options.rule.ranking_rate = glm::vec3(v[0], v[1], v[2]);
+    }
+    else if (name == "--perfect-rate")
+    {
+      options.rule.perfect_score_rate = std::stof(value);
+    }
+    else if (name == "--csv")
+    {
+      options.csv_path = value;
+    }
+    else if (name == "--json")
+    {
+      options.json_path = value;
+    }
+    else
+    {
+      std::cerr << "unknown option: " << name << std::endl;
+      return false;
+    }
+  }
+
+  return true;
+}
+
+
+// 1ゲーム遊ぶ
+Result playGame(const Options& options, const std::vector<Panel>& panels, uint32_t seed)
+{
+  Simulator sim(options.rule, panels, seed);
+  // 置く場所を決める時の乱数
+  std::mt19937 engine(seed ^ 0x9e3779b9);
+
+  sim.preparationPanel();
+  sim.putFirstPanel();
+
+  glm::ivec2 last_pos(0, 0);
+  while (sim.getNextPanel())
+  {
+    auto places = sim.searchHandPanelPlaces();
+    auto place  = choosePlace(options.policy, sim, places, last_pos, engine);
+
+    sim.hand_rotation = place.second;
+    sim.putHandPanel(place.first);
+    sim.checkCompleted(place.first);
+    last_pos = place.first;
+  }
+
+  Result result;
+  const auto& scores = sim.getScores();
+  std::copy(std::begin(scores), std::end(scores), result.values);
+
+  auto total_score = sim.calcTotalScore();
+  result.values[Result::TOTAL_SCORE]   = total_score;
+  result.values[Result::TOTAL_RANKING] = sim.calcRanking(total_score);
+  result.values[Result::PERFECT]       = sim.isPerfect() ? 1 : 0;
+
+  return result;
+}
+
+
+// 集計
+struct Summary
+{
+  double mean;
+  double stddev;
+  u_int min;
+  u_int p10;
+  u_int p50;
+  u_int p90;
+  u_int max;
+};
+
+Summary summarize(std::vector<u_int>& values)
+{
+  Summary s;
+
+  double sum  = 0;
+  double sum2 = 0;
+  for (auto v : values)
+  {
+    sum  += v;
+    sum2 += double(v) * v;
+  }
+  double n = double(values.size());
+  s.mean   = sum / n;
+  s.stddev = std::sqrt(std::max(sum2 / n - s.mean * s.mean, 0.0));
+
+  std::sort(std::begin(values), std::end(values));
+  auto at = [&values](double q)
+            {
+              return values[size_t(q * (values.size() - 1) + 0.5)];
+            };
+  s.min = values.front();
+  s.p10 = at(0.1);
+  s.p50 = at(0.5);
+  s.p90 = at(0.9);
+  s.max = values.back();
+
+  return s;
+}
+
+}
+
+
+int main(int argc, char* argv[])
+{
+  Options options;
+  if (!parseOptions(argc, argv, options) || options.games == 0)
+  {
+    std::cerr << "usage: runner [--games N] [--threads N] [--seed N] [--policy random|greedy|nearest]"
+                 " [--panel-rate x,y] [--score-rates a,b,c,d,e,f] [--ranking-rate x,y,z] [--perfect-rate x]"
+                 " [--csv PATH] [--json PATH]" << std::endl;
+    return 1;
+  }
+
+  u_int threads = options.threads ? options.threads : std::max(std::thread::hardware_concurrency(), 1u);
+  const auto& panels = createPanels();
+
+  // ゲームごとに結果の場所が決まっているので、スレッド数によらず同じ結果になる
+  std::vector<Result> results(options.games);
+  std::atomic<size_t> next(0);
+  // TIPS 少しずつ取り出すことで、早く終わったスレッドが残りを引き受ける
+  const size_t chunk = 64;
+
+  auto start_time = std::chrono::steady_clock::now();
+
+  std::vector<std::thread> workers;
+  for (u_int t = 0; t < threads; ++t)
+  {
+    workers.emplace_back([&]()
+                         {
+                           while (true)
+                           {
+                             size_t begin = next.fetch_add(chunk);
+                             if (begin >= options.games) break;
+
+                             size_t end = std::min(begin + chunk, options.games);
+                             for (size_t i = begin; i < end; ++i)
+                             {
+                               results[i] = playGame(options, panels, options.seed + uint32_t(i));
+                             }
+                           }
+                         });
+  }
+  for (auto& w : workers)
+  {
+    w.join();
+  }
+
+  auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count();
+
+  std::vector<Summary> summaries;
+  std::vector<size_t> ranking_histogram(10, 0);
+  {
+    std::vector<u_int> values(results.size());
+    for (int c = 0; c < Result::NUM; ++c)
+    {
+      for (size_t i = 0; i < results.size(); ++i)
+      {
+        values[i] = results[i].values[c];
+      }
+      summaries.push_back(summarize(values));
+    }
+    for (const auto& r : results)
+    {
+      ranking_histogram[std::min(r.values[Result::TOTAL_RANKING], 9u)] += 1;
+    }
+  }
+  double perfect_rate = summaries[Result::PERFECT].mean;
+
+  std::cout << options.games << " games, " << threads << " threads, "
+            << elapsed << " sec (" << options.games / elapsed << " games/sec)" << std::endl;
+  std::cout << "perfect rate: " << perfect_rate << std::endl;
+  for (int c = 0; c < Result::PERFECT; ++c)
+  {
+    const auto& s = summaries[c];
+    std::cout << component_names[c] << ": mean " << s.mean << " sd " << s.stddev
+              << " [" << s.min << ", " << s.p50 << ", " << s.max << "]" << std::endl;
+  }
+
+  if (!options.csv_path.empty())
+  {
+    std::ofstream os(options.csv_path);
+    os << "component,mean,stddev,min,p10,p50,p90,max\n";
+    for (int c = 0; c < Result::NUM; ++c)
+    {
+      const auto& s = summaries[c];
+      os << component_names[c] << ',' << s.mean << ',' << s.stddev << ','
+         << s.min << ',' << s.p10 << ',' << s.p50 << ',' << s.p90 << ',' << s.max << '\n';
+    }
+  }
+
+  if (!options.json_path.empty())
+  {
+    std::ofstream os(options.json_path);
+    os << "{\n"
+       << "  \"games\": " << options.games << ",\n"
+       << "  \"seed\": " << options.seed << ",\n"
+       << "  \"perfect_rate\": " << perfect_rate << ",\n"
+       << "  \"ranking_histogram\": [";
+    for (size_t i = 0; i < ranking_histogram.size(); ++i)
+    {
+      os << (i ? ", " : " ") << ranking_histogram[i];
+    }
+    os << " ],\n"
+       << "  \"components\": {\n";
+    for (int c = 0; c < Result::NUM; ++c)
+    {
+      const auto& s = summaries[c];
+      os << "    \"" << component_names[c] << "\": { "
+         << "\"mean\": " << s.mean << ", \"stddev\": " << s.stddev
+         << ", \"min\": " << s.min << ", \"p10\": " << s.p10 << ", \"p50\": " << s.p50
+         << ", \"p90\": " << s.p90 << ", \"max\": " << s.max << " }"
+         << (c + 1 < Result::NUM ? ",\n" : "\n");
+    }
+    os << "  }\n"
+       << "}\n";
+  }
+
+  return 0;
+}
@@ -0,0 +1,133 @@
+﻿//
+// 配られたパネルを全て置けるか(Perfectを取れるか)調べるやつ
+//
+// solver [options]
+//   --seed N            最初に調べる乱数の種(Gameと同じ配り方)
+//   --count N           調べる配りの数
+//   --threads N         スレッド数(0でコア数)
+//   --table-mb N        置換表のメモリ量[MB]
+//   --max-nodes N       １つの配りで調べる局面数の上限(0で無制限)
+//   --witness           置ける手順を表示する
+//
+
+#include <iostream>
+#include <string>
+#include <chrono>
+#include "Simulator.hpp"
+#include "Solver.hpp"
+
+
+using namespace ngs;
+
+namespace {
+
+struct Options
+{
+  uint32_t seed = 1;
+  size_t count  = 1;
+  u_int threads = 0;
+  size_t table_mb    = 64;
+  uint64_t max_nodes = 0;
+  bool witness = false;
+};
+
+bool parseOptions(int argc, char* argv[], Options& options)
+{
+  for (int i = 1; i < argc; ++i)
+  {
+    std::string name = argv[i];
+    if (name == "--witness")
+    {
+      options.witness = true;
+      continue;
+    }
+
+    if (i + 1 == argc)
+    {
+      std::cerr << "missing value: " << name << std::endl;
+      return false;
+    }
+    std::string value = argv[++i];
+
+    if (name == "--seed")
+    {
+      options.seed = std::stoul(value);
+    }
+    else if (name == "--count")
+    {
+      options.count = std::stoull(value);
+    }
+    else if (name == "--threads")
+    {
+      options.threads = std::stoul(value);
+    }
+    else if (name == "--table-mb")
+    {
+      options.table_mb = std::stoull(value);
+    }
+    else if (name == "--max-nodes")
+    {
+      options.max_nodes = std::stoull(value);
+    }
+    else
+    {
+      std::cerr << "unknown option: " << name << std::endl;
+      return false;
+    }
+  }
+
+  return true;
+}
+
+}
+
+
+int main(int argc, char* argv[])
+{
+  Options options;
+  if (!parseOptions(argc, argv, options))
+  {
+    std::cerr << "usage: solver [--seed N] [--count N] [--threads N] [--table-mb N] [--max-nodes N] [--witness]" << std::endl;
+    return 1;
+  }
+
+  u_int threads = options.threads ? options.threads : std::max(std::thread::hardware_concurrency(), 1u);
+  const auto& panels = createPanels();
+  // NOTICE 配るだけなので得点計算用パラメーターは使わない
+  Rule rule { glm::vec2(0), std::vector<float>(6, 0.0f), glm::vec3(0), 1.0f };
+
+  Solver solver(panels, options.table_mb * 1024 * 1024, threads);
+
+  size_t counts[3] {};
+  for (size_t i = 0; i < options.count; ++i)
+  {
+    uint32_t seed = options.seed + uint32_t(i);
+
+    // Gameと同じ配り
+    Simulator sim(rule, panels, seed);
+    sim.preparationPanel();
+    auto rotation = sim.putFirstPanel();
+
+    auto start_time = std::chrono::steady_clock::now();
+    auto result = solver.solve(sim.getStartPanel(), rotation, sim.waiting_panels, options.max_nodes);
+    auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count();
+
+    const char* label = result.solved ? "solvable" : result.exhausted ? "unsolvable" : "unknown";
+    counts[result.solved ? 0 : result.exhausted ? 1 : 2] += 1;
+    std::cout << "seed " << seed << ": " << label
+              << " (" << result.nodes << " nodes, " << elapsed << " sec)" << std::endl;
+
+    if (options.witness && result.solved)
+    {
+      for (const auto& step : result.witness)
+      {
+        std::cout << "  " << step.panel << " (" << step.position.x << ", " << step.position.y << ") " << step.rotation << std::endl;
+      }
+    }
+  }
+
+  std::cout << options.count << " deals: "
+            << counts[0] << " solvable, " << counts[1] << " unsolvable, " << counts[2] << " unknown" << std::endl;
+
+  return 0;
+}
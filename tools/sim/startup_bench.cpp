@@ -0,0 +1,363 @@
+﻿//
+// 起動時のファイル読み込みを、以前の読み込み方とMappedFileを使う読み込み方で比べるやつ
+//   起動時に読むファイル(params.json, settings.json, ui_*.json, tw_*.json, *.lang, シェーダー)を順に読む
+//   読み込んだ内容は、次のファイルを読む前に捨てる(アプリでも解析した後は残さない)
+//
+// startup_bench [options]
+//   --assets PATH       assetsのディレクトリ
+//   --loops N           繰り返す回数
+//
+// 以前の読み込み方(ci::loadFile + ci::loadString)
+//   ファイル全体をヒープのBufferへ読み、それをstd::stringへコピーする
+//   難読化されたparams.dataはstd::stringへ読んでから伸長する
+//
+// MappedFileを使う読み込み方(Asset::loadString, Asset::map, TextCodec::load)
+//   JSONとシェーダーはstd::stringへ１回だけ読む
+//   .langは読み込んだ領域を直接分割する
+//   params.dataは読み込んだ領域から、元の大きさで確保した領域へ直接伸長する
+//   NOTICE 大きいファイルはマップする(起動時に読むファイルは全て小さいので、マップしない)
+//          マップする場合は、1MBのJSONを作って比べる
+//
+
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <map>
+#include <memory>
+#include <chrono>
+#include <cstdlib>
+#include <new>
+#include <boost/filesystem.hpp>
+#include <boost/algorithm/string/split.hpp>
+#include <boost/algorithm/string/classification.hpp>
+#include <boost/range/iterator_range.hpp>
+#include "MappedFile.hpp"
+#include "TextCodec.hpp"
+
+
+// ヒープの使用量を調べる
+namespace {
+
+size_t heap_current = 0;
+size_t heap_peak    = 0;
+size_t heap_total   = 0;
+
+}
+
+void* operator new(size_t size)
+{
+  // NOTICE 解放する時のために、大きさを先頭に記録しておく
+  auto* p = static_cast<size_t*>(std::malloc(size + sizeof(max_align_t)));
+  if (!p) throw std::bad_alloc();
+  *p = size;
+
+  heap_current += size;
+  heap_total   += size;
+  heap_peak = std::max(heap_peak, heap_current);
+
+  return reinterpret_cast<char*>(p) + sizeof(max_align_t);
+}
+
+void operator delete(void* ptr) noexcept
+{
+  if (!ptr) return;
+
+  auto* p = reinterpret_cast<size_t*>(static_cast<char*>(ptr) - sizeof(max_align_t));
+  heap_current -= *p;
+  std::free(p);
+}
+
+void operator delete(void* ptr, size_t) noexcept
+{
+  operator delete(ptr);
+}
+
+
+namespace {
+
+struct Options
+{
+  std::string assets_path = PAM_ASSETS_PATH;
+  size_t loops = 200;
+};
+
+struct Asset
+{
+  enum Type {
+    TEXT,
+    LANG,
+    OBFUSCATED,
+  };
+
+  Type type;
+  std::string path;
+  size_t size;
+};
+
+struct Result
+{
+  double seconds = 0;
+  // 読み込みのために確保した大きさ(１回の起動)
+  size_t allocated = 0;
+  // ファイル１つを読む間に増えたヒープの最大
+  size_t peak = 0;
+  // ファイルの内容をコピーした大きさ(１回の起動)
+  size_t copied = 0;
+};
+
+
+bool parseOptions(int argc, char* argv[], Options& options)
+{
+  for (int i = 1; i < argc; ++i)
+  {
+    std::string name = argv[i];
+    if (i + 1 == argc)
+    {
+      std::cerr << "missing value: " << name << std::endl;
+      return false;
+    }
+    std::string value = argv[++i];
+
+    if (name == "--assets")
+    {
+      options.assets_path = value;
+    }
+    else if (name == "--loops")
+    {
+      options.loops = std::stoull(value);
+    }
+    else
+    {
+      std::cerr << "unknown option: " << name << std::endl;
+      return false;
+    }
+  }
+
+  return options.loops > 0;
+}
+
+
+// 起動時に読むファイル
+std::vector<Asset> collectAssets(const Options& options)
+{
+  namespace fs = boost::filesystem;
+
+  std::vector<Asset> assets;
+  for (fs::directory_iterator it(options.assets_path), end; it != end; ++it)
+  {
+    auto name = it->path().filename().string();
+    auto ext  = it->path().extension().string();
+
+    bool json = (ext == ".json")
+                && (name == "params.json" || name == "settings.json"
+                    || name.compare(0, 3, "ui_") == 0 || name.compare(0, 3, "tw_") == 0);
+    if (json || ext == ".vsh" || ext == ".fsh")
+    {
+      assets.push_back({ Asset::TEXT, it->path().string(), size_t(fs::file_size(it->path())) });
+    }
+    else if (ext == ".lang")
+    {
+      assets.push_back({ Asset::LANG, it->path().string(), size_t(fs::file_size(it->path())) });
+    }
+  }
+  std::sort(std::begin(assets), std::end(assets),
+            [](const Asset& a, const Asset& b)
+            {
+              return a.path < b.path;
+            });
+
+  return assets;
+}
+
+
+// ci::loadFileと同じ読み込み
+std::unique_ptr<char[]> readBuffer(const std::string& path, size_t& size)
+{
+  std::ifstream fstr(path, std::ios::binary);
+  fstr.seekg(0, std::ios::end);
+  size = size_t(fstr.tellg());
+  fstr.seekg(0, std::ios::beg);
+
+  std::unique_ptr<char[]> buffer(new char[size]);
+  fstr.read(buffer.get(), size);
+  return buffer;
+}
+
+std::vector<std::string> splitLang(const char* text, size_t size)
+{
+  std::vector<std::string> result;
+  boost::algorithm::split(result, boost::make_iterator_range(text, text + size),
+                          boost::is_any_of("\t\n"), boost::token_compress_on);
+  return result;
+}
+
+// 以前の読み込み方
+size_t loadLegacy(const Asset& asset, size_t& copied)
+{
+  switch (asset.type)
+  {
+  case Asset::TEXT:
+    {
+      size_t size;
+      auto buffer = readBuffer(asset.path, size);
+      std::string text(buffer.get(), size);
+      copied += size * 2;
+      return text.size();
+    }
+
+  case Asset::LANG:
+    {
+      size_t size;
+      auto buffer = readBuffer(asset.path, size);
+      std::string text(buffer.get(), size);
+      copied += size * 2;
+      return splitLang(text.data(), text.size()).size();
+    }
+
+  case Asset::OBFUSCATED:
+    {
+      std::ifstream fstr(asset.path, std::ios::binary);
+      std::string input((std::istreambuf_iterator<char>(fstr)),
+                        std::istreambuf_iterator<char>());
+      copied += input.size();
+      return ngs::TextCodec::decode(input).size();
+    }
+  }
+
+  return 0;
+}
+
+// MappedFileを使う読み込み方
+size_t loadMapped(const Asset& asset, size_t& copied)
+{
+  switch (asset.type)
+  {
+  case Asset::TEXT:
+    {
+      ngs::MappedFile file(asset.path);
+      auto text = file.release();
+      copied += text.size();
+      return text.size();
+    }
+
+  case Asset::LANG:
+    {
+      ngs::MappedFile file(asset.path);
+      return splitLang(file.data(), file.size()).size();
+    }
+
+  case Asset::OBFUSCATED:
+    return ngs::TextCodec::load(asset.path).size();
+  }
+
+  return 0;
+}
+
+
+template <typename F>
+Result measure(const Options& options, const std::vector<Asset>& assets, F func)
+{
+  using clock = std::chrono::steady_clock;
+
+  Result result;
+  size_t check = 0;
+
+  // １回目でヒープの使用量を調べる
+  auto total = heap_total;
+  for (const auto& asset : assets)
+  {
+    auto current = heap_current;
+    heap_peak = current;
+    check += func(asset, result.copied);
+    result.peak = std::max(result.peak, heap_peak - current);
+  }
+  result.allocated = heap_total - total;
+
+  auto start = clock::now();
+  for (size_t i = 0; i < options.loops; ++i)
+  {
+    size_t copied = 0;
+    for (const auto& asset : assets)
+    {
+      check += func(asset, copied);
+    }
+  }
+  result.seconds = std::chrono::duration<double>(clock::now() - start).count() / options.loops;
+
+  // NOTICE 読み込みが最適化で消されないように
+  if (check == 0) std::cerr << "empty" << std::endl;
+
+  return result;
+}
+
+void printResult(const char* name, const Result& result)
+{
+  std::cout << std::setw(8) << name
+            << std::fixed << std::setprecision(1)
+            << std::setw(10) << result.seconds * 1e6 << " us"
+            << std::setw(10) << result.allocated / 1024.0 << " KB allocated"
+            << std::setw(10) << result.peak / 1024.0 << " KB peak"
+            << std::setw(10) << result.copied / 1024.0 << " KB copied\n";
+}
+
+}
+
+
+int main(int argc, char* argv[])
+{
+  Options options;
+  if (!parseOptions(argc, argv, options))
+  {
+    std::cerr << "usage: startup_bench [--assets PATH] [--loops N]" << std::endl;
+    return 1;
+  }
+
+  auto assets = collectAssets(options);
+  size_t total_size = 0;
+  for (const auto& asset : assets)
+  {
+    total_size += asset.size;
+  }
+
+  // 難読化されたparams.data(OBFUSCATION_PARAMS)
+  auto params_data = (boost::filesystem::temp_directory_path() / "startup_bench_params.data").string();
+  {
+    std::ifstream fstr(options.assets_path + "/params.json", std::ios::binary);
+    std::string text((std::istreambuf_iterator<char>(fstr)),
+                     std::istreambuf_iterator<char>());
+    ngs::TextCodec::write(params_data, text);
+  }
+  std::vector<Asset> obfuscated { { Asset::OBFUSCATED, params_data, size_t(boost::filesystem::file_size(params_data)) } };
+
+  std::cout << assets.size() << " files, " << total_size / 1024.0 << " KB\n";
+  printResult("legacy", measure(options, assets, loadLegacy));
+  printResult("mapped", measure(options, assets, loadMapped));
+
+  std::cout << "params.data, " << obfuscated[0].size / 1024.0 << " KB\n";
+  printResult("legacy", measure(options, obfuscated, loadLegacy));
+  printResult("mapped", measure(options, obfuscated, loadMapped));
+
+  // 大きいファイル(マップする)
+  auto large_json = (boost::filesystem::temp_directory_path() / "startup_bench_large.json").string();
+  {
+    std::string text;
+    while (text.size() < 1024 * 1024)
+    {
+      text += "{ \"score\": " + std::to_string(text.size()) + ", \"rank\": 3, \"date\": \"2018-6-1\" },\n";
+    }
+    std::ofstream fstr(large_json, std::ios::binary);
+    fstr << text;
+  }
+  std::vector<Asset> large { { Asset::TEXT, large_json, size_t(boost::filesystem::file_size(large_json)) } };
+
+  std::cout << "large json, " << large[0].size / 1024.0 << " KB\n";
+  printResult("legacy", measure(options, large, loadLegacy));
+  printResult("mapped", measure(options, large, loadMapped));
+
+  boost::filesystem::remove(params_data);
+  boost::filesystem::remove(large_json);
+
+  return 0;
+}
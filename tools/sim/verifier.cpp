@@ -0,0 +1,580 @@
+﻿//
+// 保存されたゲーム記録(game-*.data, game-*.json)を一括で検証するやつ
+//   置いた順番から盤面を作り直して、完成判定とスコアを計算し直す
+//   記録された得点やランクと食い違うものを報告する
+//
+// verifier [options] PATH...
+//   PATH                記録ファイルかディレクトリ(game-*.data, game-*.jsonを再帰的に探す)
+//   --archive PATH      records.json(記録に得点が無い時はここのランキングと比べる)
+//   --params PATH       params.json(得点計算用パラメーター)
+//   --threads N         スレッド数(0でコア数)
+//
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <map>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <boost/filesystem.hpp>
+#include "MoveLog.hpp"
+#include "GameRecord.hpp"
+#include "MiniJson.hpp"
+#include "TextCodec.hpp"
+
+
+using namespace ngs;
+
+namespace {
+
+namespace fs = boost::filesystem;
+
+struct Options
+{
+  std::vector<std::string> paths;
+  std::string archive_path;
+  std::string params_path = PAM_PARAMS_PATH;
+  u_int threads = 0;
+};
+
+// 記録された得点
+struct Stored
+{
+  u_int score;
+  u_int rank;
+};
+
+enum class Status {
+  OK,
+  MISMATCH,
+  // 得点の記録が無い
+  UNSCORED,
+  BROKEN,
+};
+
+
+bool parseOptions(int argc, char* argv[], Options& options)
+{
+  for (int i = 1; i < argc; ++i)
+  {
+    std::string name = argv[i];
+    if (name.compare(0, 2, "--") != 0)
+    {
+      options.paths.push_back(name);
+      continue;
+    }
+
+    if (i + 1 == argc)
+    {
+      std::cerr << "missing value: " << name << std::endl;
+      return false;
+    }
+    std::string value = argv[++i];
+
+    if (name == "--archive")
+    {
+      options.archive_path = value;
+    }
+    else if (name == "--params")
+    {
+      options.params_path = value;
+    }
+    else if (name == "--threads")
+    {
+      options.threads = std::stoul(value);
+    }
+    else
+    {
+      std::cerr << "unknown option: " << name << std::endl;
+      return false;
+    }
+  }
+
+  return !options.paths.empty();
+}
+
+
+std::string readFile(const std::string& path)
+{
+  std::ifstream fstr(path, std::ios::binary);
+  return std::string((std::istreambuf_iterator<char>(fstr)),
+                     std::istreambuf_iterator<char>());
+}
+
+// 難読化されていてもいなくても読む
+bool parseJson(std::string text, MiniJson::Value& json)
+{
+  auto pos = text.find_first_not_of(" \t\r\n\xef\xbb\xbf");
+  if (pos == std::string::npos) return false;
+  if (text[pos] != '{' && text[pos] != '[')
+  {
+    text = TextCodec::decode(text);
+  }
+
+  return MiniJson::parse(text, json);
+}
+
+bool loadJson(const std::string& path, MiniJson::Value& json)
+{
+  std::ifstream fstr(path, std::ios::binary);
+  if (!fstr) return false;
+
+  return parseJson(readFile(path), json);
+}
+
+glm::ivec2 getVec(const MiniJson::Value& json)
+{
+  if (json.size() != 2) return glm::ivec2(0);
+  return glm::ivec2(int(json[0].asInt()), int(json[1].asInt()));
+}
+
+std::vector<glm::ivec2> getVecArray(const MiniJson::Value& json)
+{
+  std::vector<glm::ivec2> array;
+  for (const auto& v : json.array)
+  {
+    array.push_back(getVec(v));
+  }
+  return array;
+}
+
+std::vector<std::vector<glm::ivec2>> getVecVecArray(const MiniJson::Value& json)
+{
+  std::vector<std::vector<glm::ivec2>> array;
+  for (const auto& v : json.array)
+  {
+    array.push_back(getVecArray(v));
+  }
+  return array;
+}
+
+template <typename T>
+std::vector<T> getArray(const MiniJson::Value& json)
+{
+  std::vector<T> array;
+  for (const auto& v : json.array)
+  {
+    array.push_back(T(v.asInt()));
+  }
+  return array;
+}
+
+std::vector<float> getFloatArray(const MiniJson::Value& json)
+{
+  std::vector<float> array;
+  for (const auto& v : json.array)
+  {
+    array.push_back(float(v.asDouble()));
+  }
+  return array;
+}
+
+std::string fromHex(const std::string& text)
+{
+  auto value = [](char c)
+               {
+                 return (c <= '9') ? c - '0' : c - 'a' + 10;
+               };
+
+  std::string data;
+  for (size_t i = 0; i + 1 < text.size(); i += 2)
+  {
+    data.push_back(char((value(text[i]) << 4) | value(text[i + 1])));
+  }
+  return data;
+}
+
+
+// params.jsonから得点計算用パラメーターを取り出す
+bool loadRule(const std::string& path, Rule& rule)
+{
+  MiniJson::Value json;
+  if (!loadJson(path, json)) return false;
+
+  const auto& game = json["game"];
+  auto panel_rate   = getFloatArray(game["panel_rate"]);
+  auto ranking_rate = getFloatArray(game["ranking_rate"]);
+  rule.score_rates  = getFloatArray(game["score_rates"]);
+  if (panel_rate.size() != 2 || ranking_rate.size() != 3 || rule.score_rates.size() != 6) return false;
+
+  rule.panel_rate         = glm::vec2(panel_rate[0], panel_rate[1]);
+  rule.ranking_rate       = glm::vec3(ranking_rate[0], ranking_rate[1], ranking_rate[2]);
+  rule.perfect_score_rate = float(game["perfect_score_rate"].asDouble());
+
+  return true;
+}
+
+// records.jsonのランキングからファイル名→得点
+std::map<std::string, Stored> loadArchive(const std::string& path)
+{
+  std::map<std::string, Stored> stored;
+
+  MiniJson::Value json;
+  if (!loadJson(path, json))
+  {
+    std::cerr << "archive broken: " << path << std::endl;
+    return stored;
+  }
+
+  for (const auto& g : json["games"].array)
+  {
+    if (!g.has("path")) continue;
+    stored.emplace(g["path"].text, Stored{ u_int(g["score"].asInt()), u_int(g["rank"].asInt()) });
+  }
+
+  return stored;
+}
+
+
+// JSONで保存していた頃の記録を変換(Game::readJsonRecordと同じ)
+// NOTICE JSONの記録には辺の情報があるので、ここで確かめる
+Status convertJsonRecord(const MiniJson::Value& json, const std::vector<Panel>& panels,
+                         GameRecord& record, std::string& message)
+{
+  const auto& field = json["field"];
+  for (size_t i = 0; i < field.size(); ++i)
+  {
+    const auto& obj = field[i];
+    auto number   = int(obj["number"].asInt());
+    auto pos      = getVec(obj["pos"]);
+    auto rotation = u_int(obj["rotation"].asInt());
+
+    if (number < 0 || number >= int(panels.size()) || rotation > 3)
+    {
+      message = "invalid panel #" + std::to_string(i);
+      return Status::BROKEN;
+    }
+
+    if (obj.has("edge") && obj["edge"].asUInt64() != panels[number].getRotatedEdgeValue(rotation))
+    {
+      message = "edge mismatch #" + std::to_string(i);
+      return Status::MISMATCH;
+    }
+
+    record.panels.push_back({ number, pos, rotation });
+  }
+
+  record.waiting_panels    = getArray<int>(json["waiting_panels"]);
+  record.flags             = json["tutorial"].asBool() ? GameRecord::TUTORIAL : 0;
+  record.completed_forests = getVecVecArray(json["completed_forests"]);
+  record.deep_forest       = getArray<u_int>(json["deep_forest"]);
+  record.completed_path    = getVecVecArray(json["completed_path"]);
+  record.completed_church  = getVecArray(json["completed_church"]);
+
+  if (json.has("move_log"))
+  {
+    record.move_log = fromHex(json["move_log"].text);
+  }
+  if (json.has("total_score"))
+  {
+    record.flags        |= GameRecord::SCORED;
+    record.total_score   = u_int(json["total_score"].asInt());
+    record.total_ranking = u_int(json["total_ranking"].asInt());
+  }
+
+  // 手持ちと待ちパネルの番号、置いた場所の重なり
+  if (!record.validate(panels.size()))
+  {
+    message = "invalid record";
+    return Status::BROKEN;
+  }
+
+  return Status::OK;
+}
+
+// 記録を読む(バイナリでもJSONでも)
+Status loadRecord(const std::string& path, const std::vector<Panel>& panels,
+                  GameRecord& record, std::string& message)
+{
+  auto data = readFile(path);
+  if (GameRecord::isRecord(data.data(), data.size()))
+  {
+    // NOTICE パネル番号と置いた場所もここで確かめる
+    if (!record.deserialize(data.data(), data.size(), panels.size()))
+    {
+      message = "can't parse";
+      return Status::BROKEN;
+    }
+    return Status::OK;
+  }
+
+  MiniJson::Value json;
+  if (!parseJson(data, json))
+  {
+    message = "can't parse";
+    return Status::BROKEN;
+  }
+  return convertJsonRecord(json, panels, record, message);
+}
+
+
+// 記録を１つ検証
+Status verifyRecord(const GameRecord& record, const Rule& rule, const std::vector<Panel>& panels,
+                    const Stored* archived, std::string& message)
+{
+  const auto& field = record.panels;
+  if (field.size() == 0)
+  {
+    message = "no panels";
+    return Status::BROKEN;
+  }
+
+  // 置いた順に並べ直す
+  Simulator sim(rule, panels, 0);
+  for (size_t i = 0; i < field.size(); ++i)
+  {
+    auto number   = field[i].number;
+    const auto& pos = field[i].position;
+    auto rotation = field[i].rotation;
+    const auto& panel = panels[number];
+
+    // 最初のパネル以外は置ける場所か調べる
+    if (i > 0)
+    {
+      const auto& f = sim.getField();
+      if (!f.isBlank(pos) || !((getPutableRotation(panel, f.getBlankEdge(pos)) >> rotation) & 1))
+      {
+        message = "illegal placement #" + std::to_string(i);
+        return Status::MISMATCH;
+      }
+    }
+
+    sim.putPanel(number, pos, rotation);
+    if (i > 0) sim.checkCompleted(pos);
+  }
+
+  sim.total_panels   = u_int(field.size()) - 1;
+  sim.waiting_panels = record.waiting_panels;
+  sim.setTutorial(record.flags & GameRecord::TUTORIAL);
+
+  // 完成したもの
+  if (sim.completed_forests != record.completed_forests
+      || sim.deep_forest    != record.deep_forest)
+  {
+    message = "forest mismatch";
+    return Status::MISMATCH;
+  }
+  if (sim.completed_path != record.completed_path)
+  {
+    message = "path mismatch";
+    return Status::MISMATCH;
+  }
+  if (sim.completed_church != record.completed_church)
+  {
+    message = "church mismatch";
+    return Status::MISMATCH;
+  }
+
+  // 配られたパネルと置いた順番が一致するか
+  if (!record.move_log.empty() && !sim.isTutorial())
+  {
+    MoveLog log;
+    if (!log.deserialize(record.move_log))
+    {
+      message = "move log broken";
+      return Status::BROKEN;
+    }
+    Simulator s(rule, panels, log.getSeed());
+    if (!log.replay(s) || log.getMoves().size() != field.size())
+    {
+      message = "move log mismatch";
+      return Status::MISMATCH;
+    }
+    const auto& statuses = s.getField().enumeratePanels();
+    for (size_t i = 0; i < field.size(); ++i)
+    {
+      if (statuses[i].number != field[i].number
+          || statuses[i].position != field[i].position
+          || statuses[i].rotation != field[i].rotation)
+      {
+        message = "move log mismatch #" + std::to_string(i);
+        return Status::MISMATCH;
+      }
+    }
+  }
+
+  auto score = sim.calcTotalScore();
+  auto rank  = sim.calcRanking(score);
+
+  Stored stored;
+  if (record.flags & GameRecord::SCORED)
+  {
+    stored = { record.total_score, record.total_ranking };
+  }
+  else if (archived)
+  {
+    stored = *archived;
+  }
+  else
+  {
+    message = "score " + std::to_string(score) + " rank " + std::to_string(rank);
+    return Status::UNSCORED;
+  }
+
+  if (stored.score != score || stored.rank != rank)
+  {
+    message = "score " + std::to_string(stored.score) + " -> " + std::to_string(score)
+            + ", rank " + std::to_string(stored.rank) + " -> " + std::to_string(rank);
+    return Status::MISMATCH;
+  }
+
+  return Status::OK;
+}
+
+
+// 検証するファイルを１つずつ取り出す
+// NOTICE 全ファイルを先に列挙しないので、件数が多くてもメモリを食わない
+class RecordQueue
+{
+public:
+  RecordQueue(const std::vector<std::string>& paths)
+    : paths_(paths)
+  {
+  }
+
+  bool next(std::string& path)
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    while (true)
+    {
+      if (walking_)
+      {
+        boost::system::error_code ec;
+        while (it_ != fs::recursive_directory_iterator())
+        {
+          auto p = it_->path();
+          it_.increment(ec);
+          if (isRecord(p))
+          {
+            path = p.string();
+            return true;
+          }
+        }
+        walking_ = false;
+      }
+
+      if (index_ == paths_.size()) return false;
+
+      fs::path p(paths_[index_++]);
+      if (fs::is_directory(p))
+      {
+        it_      = fs::recursive_directory_iterator(p);
+        walking_ = true;
+      }
+      else
+      {
+        path = p.string();
+        return true;
+      }
+    }
+  }
+
+
+private:
+  static bool isRecord(const fs::path& p)
+  {
+    auto name = p.filename().string();
+    return fs::is_regular_file(p)
+           && name.compare(0, 5, "game-") == 0
+           && (p.extension() == ".data" || p.extension() == ".json");
+  }
+
+
+  std::mutex mutex_;
+
+  const std::vector<std::string>& paths_;
+  size_t index_ = 0;
+
+  fs::recursive_directory_iterator it_;
+  bool walking_ = false;
+};
+
+}
+
+
+int main(int argc, char* argv[])
+{
+  Options options;
+  if (!parseOptions(argc, argv, options))
+  {
+    std::cerr << "usage: verifier [--archive PATH] [--params PATH] [--threads N] PATH..." << std::endl;
+    return 1;
+  }
+
+  Rule rule;
+  if (!loadRule(options.params_path, rule))
+  {
+    std::cerr << "can't read params: " << options.params_path << std::endl;
+    return 1;
+  }
+
+  std::map<std::string, Stored> archive;
+  if (!options.archive_path.empty())
+  {
+    archive = loadArchive(options.archive_path);
+  }
+
+  u_int threads = options.threads ? options.threads : std::max(std::thread::hardware_concurrency(), 1u);
+  const auto& panels = createPanels();
+
+  RecordQueue queue(options.paths);
+  std::mutex output_mutex;
+
+  std::atomic<size_t> counts[4] {};
+
+  auto start_time = std::chrono::steady_clock::now();
+
+  std::vector<std::thread> workers;
+  for (u_int t = 0; t < threads; ++t)
+  {
+    workers.emplace_back([&]()
+                         {
+                           std::string path;
+                           while (queue.next(path))
+                           {
+                             Status status;
+                             std::string message;
+
+                             GameRecord record;
+                             status = loadRecord(path, panels, record, message);
+                             if (status == Status::OK)
+                             {
+                               auto it = archive.find(fs::path(path).filename().string());
+                               status = verifyRecord(record, rule, panels,
+                                                     (it != std::end(archive)) ? &it->second : nullptr,
+                                                     message);
+                             }
+
+                             counts[int(status)] += 1;
+                             if (status != Status::OK)
+                             {
+                               const char* labels[] = { "ok", "MISMATCH", "unscored", "BROKEN" };
+
+                               std::lock_guard<std::mutex> lock(output_mutex);
+                               std::cout << labels[int(status)] << ": " << path << ": " << message << std::endl;
+                             }
+                           }
+                         });
+  }
+  for (auto& w : workers)
+  {
+    w.join();
+  }
+
+  auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count();
+  size_t total = counts[0] + counts[1] + counts[2] + counts[3];
+
+  std::cout << total << " records, "
+            << counts[int(Status::OK)] << " ok, "
+            << counts[int(Status::MISMATCH)] << " mismatched, "
+            << counts[int(Status::UNSCORED)] << " unscored, "
+            << counts[int(Status::BROKEN)] << " broken" << std::endl;
+  std::cout << elapsed << " sec (" << total / std::max(elapsed, 1e-9) << " records/sec)" << std::endl;
+
+  return (counts[int(Status::MISMATCH)] || counts[int(Status::BROKEN)]) ? 2 : 0;
+}